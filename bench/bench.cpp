@@ -0,0 +1,12 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bench.hpp"
+
+// Runs all the benchmarks.
+int main() {
+	benchScan();
+	benchEncode();
+	benchSet();
+	benchFlat();
+	return 0;
+}
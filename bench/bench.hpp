@@ -0,0 +1,38 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <iostream>
+
+// Runs the function the given number of times and returns the fastest time in
+// seconds. Taking the minimum filters out noise from the rest of the system.
+template <typename F>
+double timeBest(int reps, F f) {
+	double best = 0;
+	for (int r = 0; r < reps; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - start;
+		if (r == 0 || elapsed.count() < best) {
+			best = elapsed.count();
+		}
+	}
+	return best;
+}
+
+// Prints one line of benchmark results, with the throughput in MB/s.
+inline void report(const char* name, double seconds, double bytes) {
+	std::cout << "  " << name << ": " << seconds * 1000 << " ms ("
+		<< bytes / seconds / 1e6 << " MB/s)\n";
+}
+
+// The benchmarks. Each one prints a heading followed by its results.
+void benchScan();
+void benchEncode();
+void benchSet();
+void benchFlat();
+
+#endif
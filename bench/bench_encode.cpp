@@ -0,0 +1,49 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bench.hpp"
+
+#include "batch.hpp"
+#include "encode.hpp"
+#include "sentence.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// Compares loading a library of 100,000 theorems from text (parsing on one
+// thread) to loading the same library from a binary file.
+void benchEncode() {
+	const char* text_path = "bench_encode_tmp.txt";
+	const char* flat_path = "bench_encode_tmp.bin";
+	{
+		std::ofstream out(text_path);
+		for (int i = 0; i < 100000; ++i) {
+			out << "(forall x in ZZ (iff (and (= x (+ " << i << " 1)) "
+				"(sub {x, 2, 3} ZZ)) (exists abc (= abc abc))))\n";
+		}
+	}
+	TheoremFile lib;
+	std::string err;
+	if (!lib.load(text_path, 1, err) || !lib.save(flat_path, err)) {
+		std::cout << "error: " << err << '\n';
+		return;
+	}
+	double bytes = static_cast<double>(lib._bytes);
+
+	std::cout << "Loading " << lib._sentences.size() << " theorems:\n";
+	double t = timeBest(3, [&] { lib.load(text_path, 1, err); });
+	report("parse text", t, bytes);
+	t = timeBest(3, [&] { lib.load(flat_path, 1, err); });
+	report("decode binary", t, bytes);
+	FlatFile file;
+	std::size_t nodes = 0;
+	t = timeBest(3, [&] {
+		file.open(flat_path, err);
+		for (std::size_t i = 0; i < file.size(); ++i) {
+			nodes += static_cast<std::size_t>(file.end(i) - file.begin(i));
+		}
+	});
+	report("map binary", t, bytes);
+	std::remove(text_path);
+	std::remove(flat_path);
+}
@@ -0,0 +1,93 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bench.hpp"
+
+#include "encode.hpp"
+#include "flat.hpp"
+#include "object.hpp"
+#include "sentence.hpp"
+
+#include <sstream>
+#include <vector>
+
+// Builds a balanced conjunction of the given depth whose leaves are true
+// relations (< (+ i 1) (* 2 i)), numbering the leaves from next.
+static Sentence* buildTree(int depth, long long& next) {
+	if (depth == 0) {
+		long long i = next++;
+		return new Relation(Relation::LT, true,
+			new CompoundNumber(CompoundNumber::ADD,
+				new ConcreteNumber(i), new ConcreteNumber(1)),
+			new CompoundNumber(CompoundNumber::MUL,
+				new ConcreteNumber(2), new ConcreteNumber(i)));
+	}
+	Sentence* a = buildTree(depth - 1, next);
+	Sentence* b = buildTree(depth - 1, next);
+	return new Logical(Logical::AND, a, b);
+}
+
+// Compares printing, hashing, equality, and evaluation of a large ground
+// sentence as a pointer tree and in flat postfix encoding.
+void benchFlat() {
+	const int reps = 5;
+	long long next = 2;
+	Sentence* tree = buildTree(16, next);
+	Encoder e;
+	e.add(*tree);
+	e.add(*tree);
+	const FlatCode& code = e.code();
+	const FlatNode* begin = code.begin(0);
+	const FlatNode* end = code.end(0);
+	double bytes = static_cast<double>(end - begin) * sizeof(FlatNode);
+	std::size_t sink = 0;
+
+	std::cout << "Traversing a sentence of " << (end - begin) << " nodes:\n";
+	double t = timeBest(reps, [&] {
+		std::ostringstream out;
+		out << *tree;
+		sink += out.str().size();
+	});
+	report("print tree", t, bytes);
+	t = timeBest(reps, [&] {
+		std::ostringstream out;
+		printFlat(out, begin, end, code._names);
+		sink += out.str().size();
+	});
+	report("print flat", t, bytes);
+
+	// Hashes are cached in the tree, so each run hashes a fresh copy.
+	std::vector<Sentence*> copies;
+	for (int r = 0; r < reps; ++r) {
+		copies.push_back(tree->clone());
+	}
+	std::size_t r = 0;
+	t = timeBest(reps, [&] { sink += copies[r++]->hash(); });
+	report("hash tree", t, bytes);
+	t = timeBest(reps, [&] { sink += hashFlat(begin, end); });
+	report("hash flat", t, bytes);
+
+	Sentence* other = tree->clone();
+	t = timeBest(reps, [&] { sink += tree->equal(*other); });
+	report("equal tree", t, bytes);
+	t = timeBest(reps, [&] {
+		sink += equalFlat(begin, end, code.begin(1), code.end(1), code._names);
+	});
+	report("equal flat", t, bytes);
+
+	t = timeBest(reps, [&] { sink += static_cast<std::size_t>(tree->value()); });
+	report("evaluate tree", t, bytes);
+	t = timeBest(reps, [&] {
+		Sentence::Value v;
+		sink += evaluateFlat(begin, end, v) && v == Sentence::TRUE;
+	});
+	report("evaluate flat", t, bytes);
+
+	for (Sentence* s: copies) {
+		delete s;
+	}
+	delete other;
+	delete tree;
+	if (sink == 0) {
+		std::cout << "(no work done)\n";
+	}
+}
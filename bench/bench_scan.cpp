@@ -0,0 +1,45 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bench.hpp"
+
+#include "parse.hpp"
+#include "scan.hpp"
+
+#include <string>
+
+// Compares the scalar lexer loop to each block scanner on a large input made
+// of many copies of a typical theorem.
+void benchScan() {
+	std::string text;
+	while (text.size() < 64 * 1000 * 1000) {
+		text += "(forall x in ZZ (iff (and (= x (+ 1 1)) (sub {x, 2, 3} ZZ)) "
+			"(exists abc (= abc abc))))\n";
+	}
+	const char* begin = text.data();
+	const char* end = begin + text.size();
+	double bytes = static_cast<double>(text.size());
+	TokVec tokens;
+	tokens.reserve(text.size() / 2);
+
+	std::cout << "Tokenizing " << text.size() / 1000000 << " MB:\n";
+	double t = timeBest(5, [&] {
+		tokens.clear();
+		Lexer lex(begin, end);
+		while (!lex.done()) {
+			tokens.push_back(lex.next());
+		}
+	});
+	report("lexer loop", t, bytes);
+	const char* names[] = {"scalar blocks", "sse2 blocks", "avx2 blocks"};
+	const ScanImpl impls[] = {SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2};
+	for (int k = 0; k < 3; ++k) {
+		if (!scanImplSupported(impls[k])) {
+			continue;
+		}
+		t = timeBest(5, [&] {
+			tokens.clear();
+			scanTokens(impls[k], begin, end, tokens);
+		});
+		report(names[k], t, bytes);
+	}
+}
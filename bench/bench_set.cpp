@@ -0,0 +1,53 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bench.hpp"
+
+#include "object.hpp"
+
+#include <vector>
+
+// Measures building a large concrete set, testing membership in it, and
+// combining it with another set.
+void benchSet() {
+	const int n = 1000000;
+	std::vector<Object*> items;
+	ConcreteSet* set = nullptr;
+	std::cout << "Concrete set of " << n << " integers:\n";
+	double t = timeBest(3, [&] {
+		delete set;
+		items.clear();
+		for (int i = 0; i < n; ++i) {
+			items.push_back(new ConcreteNumber((i * 7919LL) % n * 2));
+		}
+		set = new ConcreteSet(items);
+	});
+	report("build", t, n * 8.0);
+	long long hits = 0;
+	t = timeBest(3, [&] {
+		hits = 0;
+		for (long long i = 0; i < n; ++i) {
+			hits += set->contains(i);
+		}
+	});
+	report("contains", t, n * 8.0);
+	std::cout << "  (" << hits << " hits)\n";
+
+	items.clear();
+	for (int i = 0; i < n; ++i) {
+		items.push_back(new ConcreteNumber(i * 3LL));
+	}
+	ConcreteSet other(items);
+	std::size_t size = 0;
+	t = timeBest(3, [&] {
+		ConcreteSet* u = set->unite(other);
+		ConcreteSet* i = set->intersect(other);
+		ConcreteSet* d = set->subtract(other);
+		size = u->size() + i->size() + d->size();
+		delete u;
+		delete i;
+		delete d;
+	});
+	report("union/intersect/diff", t, n * 8.0);
+	std::cout << "  (" << size << " elements)\n";
+	delete set;
+}
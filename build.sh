@@ -1,29 +1,33 @@
 #!/bin/bash
 
 # This script compiles the project, producing a 'spa' executable. Use the -t
-# option (or --test) to compile the test binary instead, and use -d (or --debug)
-# to compile for debugging.
+# option (or --test) to compile the test binary instead, use -b (or --bench) to
+# compile the benchmarks, and use -d (or --debug) to compile for debugging.
 
 name=$(basename "$0")
-usage="usage: $name [-h] [-t] [-d]"
+usage="usage: $name [-h] [-t] [-b] [-d]"
 
 # Compiler and common options.
 cxx=${CXX:-clang++}
-options='-std=c++11 -Weverything -pedantic -Wno-padded -Wno-c++98-compat'
+options='-std=c++11 -pthread -Weverything -pedantic -Wno-padded -Wno-c++98-compat'
 dist_opts='-DNDEBUG -Oz'
 debug_opts='-g'
+bench_opts='-DNDEBUG -O2'
 
 # Directions and file names.
 src_dir='src'
 tst_dir='tests'
+bch_dir='bench'
 bin_dir='dist'
 output='spa'
 tst_output='test'
+bch_output='bench'
 main_file="$src_dir/spa.cpp"
 
 # Search for source files.
 src_files=$(find $src_dir -type f -name *.cpp -not -name spa.cpp)
 tst_files=$(find $tst_dir -type f -name *.cpp)
+bch_files=$(find $bch_dir -type f -name *.cpp)
 
 compile() {
 	mkdir -p $bin_dir
@@ -32,7 +36,12 @@ compile() {
 
 compile_tests() {
 	mkdir -p $bin_dir
-	$cxx $options -o $bin_dir/$tst_output $src_files $tst_files
+	$cxx $options -I$src_dir -o $bin_dir/$tst_output $src_files $tst_files
+}
+
+compile_bench() {
+	mkdir -p $bin_dir
+	$cxx $options $bench_opts -I$src_dir -o $bin_dir/$bch_output $src_files $bch_files
 }
 
 error_msg() {
@@ -47,6 +56,8 @@ elif (($# == 1)); then
 		echo "$usage"
 	elif [[ $1 == '-t' || $1 == '--test' ]]; then
 		compile_tests
+	elif [[ $1 == '-b' || $1 == '--bench' ]]; then
+		compile_bench
 	elif [[ $1 == '-d' || $1 == '--debug' ]]; then
 		compile $debug_opts
 	else
@@ -0,0 +1,128 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "arena.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+	// The size of each arena chunk. Allocations larger than a quarter of this
+	// get a chunk of their own.
+	const std::size_t chunk_size = 64 * 1024;
+
+	// Every allocation is rounded up to a multiple of this.
+	const std::size_t alignment = alignof(std::max_align_t);
+
+	// The arena that nodes are currently allocated from on this thread.
+	thread_local Arena* currentArena = nullptr;
+
+	// The number of nodes allocated on this thread.
+	thread_local std::size_t allocations = 0;
+
+	// Every node allocation is preceded by a header saying where it came from.
+	// The header is padded to the alignment so the node itself stays aligned.
+	union Header {
+		Arena* _arena; // the owning arena, or null for the heap
+		std::max_align_t _align;
+	};
+}
+
+static std::size_t roundUp(std::size_t size) {
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// Allocates a chunk, throwing std::bad_alloc on failure.
+static char* newChunk(std::size_t size) {
+	void* p = std::malloc(size);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return static_cast<char*>(p);
+}
+
+// =============================================================================
+//            Arena
+// =============================================================================
+
+Arena::Arena() : _ptr(nullptr), _end(nullptr), _bytes(0) {}
+
+Arena::~Arena() {
+	for (char* chunk: _chunks) {
+		std::free(chunk);
+	}
+}
+
+void* Arena::allocate(std::size_t size) {
+	size = roundUp(size);
+	_bytes += size;
+	if (size <= static_cast<std::size_t>(_end - _ptr)) {
+		void* p = _ptr;
+		_ptr += size;
+		return p;
+	}
+	if (size > chunk_size / 4) {
+		// Put big allocations in their own chunk before the current one, so
+		// that the rest of the current chunk is not wasted.
+		char* chunk = newChunk(size);
+		_chunks.insert(_chunks.end() - (_chunks.empty() ? 0 : 1), chunk);
+		return chunk;
+	}
+	char* chunk = newChunk(chunk_size);
+	_chunks.push_back(chunk);
+	_ptr = chunk + size;
+	_end = chunk + chunk_size;
+	return chunk;
+}
+
+void Arena::release() {
+	_bytes = 0;
+	// Keep the current chunk, since a released arena is usually reused.
+	char* keep = (_end == nullptr) ? nullptr : _end - chunk_size;
+	for (char* chunk: _chunks) {
+		if (chunk != keep) {
+			std::free(chunk);
+		}
+	}
+	_chunks.clear();
+	if (keep != nullptr) {
+		_chunks.push_back(keep);
+		_ptr = keep;
+	}
+}
+
+// =============================================================================
+//            Node allocation
+// =============================================================================
+
+ArenaScope::ArenaScope(Arena& arena) : _prev(currentArena) {
+	currentArena = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+	currentArena = _prev;
+}
+
+void* allocNode(std::size_t size) {
+	Arena* arena = currentArena;
+	++allocations;
+	void* p = arena == nullptr
+		? ::operator new(sizeof(Header) + size)
+		: arena->allocate(sizeof(Header) + size);
+	Header* h = static_cast<Header*>(p);
+	h->_arena = arena;
+	return h + 1;
+}
+
+void freeNode(void* p) {
+	if (p == nullptr) {
+		return;
+	}
+	Header* h = static_cast<Header*>(p) - 1;
+	if (h->_arena == nullptr) {
+		::operator delete(h);
+	}
+}
+
+std::size_t nodeCount() {
+	return allocations;
+}
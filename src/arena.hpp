@@ -0,0 +1,96 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+// An arena is a region of memory that objects are bump-allocated from. Freeing
+// an individual allocation does nothing; instead, the whole arena is released
+// at once. This makes allocation a pointer increment and teardown of a large
+// group of objects (like all the sentences in a proof) nearly free.
+class Arena {
+public:
+	Arena();
+	~Arena();
+
+	// Allocates size bytes, aligned for any type.
+	void* allocate(std::size_t size);
+
+	// Releases all the memory allocated from the arena, without running any
+	// destructors. The first chunk is kept for reuse.
+	void release();
+
+	// Returns the number of bytes allocated since the last release.
+	std::size_t bytes() const { return _bytes; }
+
+private:
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	std::vector<char*> _chunks; // the chunks allocated so far
+	char* _ptr; // the next free byte in the current chunk
+	char* _end; // the end of the current chunk
+	std::size_t _bytes; // the number of bytes handed out
+};
+
+// An arena scope makes an arena current on this thread for its lifetime. While
+// an arena is current, all sentence and object nodes (and their vectors) are
+// allocated from it. Scopes can be nested; the innermost one wins.
+class ArenaScope {
+public:
+	explicit ArenaScope(Arena& arena);
+	~ArenaScope();
+
+private:
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+	Arena* _prev; // the arena that was current before this scope
+};
+
+// Allocates memory for a node from the current arena, or from the heap if there
+// is no current arena. Each allocation remembers where it came from, so
+// freeNode can be called on any of them: heap memory is freed immediately,
+// while arena memory is left for the arena to release.
+void* allocNode(std::size_t size);
+void freeNode(void* p);
+
+// Returns the number of nodes allocated on this thread so far, whether from the
+// heap or an arena. The difference between two calls measures how many nodes
+// an operation copied or created.
+std::size_t nodeCount();
+
+// A node allocator lets standard containers inside nodes use allocNode, so that
+// their storage lives in the same arena as the nodes that own them.
+template <typename T>
+class NodeAllocator {
+public:
+	typedef T value_type;
+
+	NodeAllocator() {}
+	template <typename U>
+	NodeAllocator(const NodeAllocator<U>&) {}
+
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(allocNode(n * sizeof(T)));
+	}
+	void deallocate(T* p, std::size_t) { freeNode(p); }
+};
+
+template <typename T, typename U>
+bool operator==(const NodeAllocator<T>&, const NodeAllocator<U>&) {
+	return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const NodeAllocator<T>&, const NodeAllocator<U>&) {
+	return false;
+}
+
+// A vector whose storage comes from allocNode.
+template <typename T>
+using NodeVec = std::vector<T, NodeAllocator<T>>;
+
+#endif
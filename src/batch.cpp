@@ -0,0 +1,255 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "batch.hpp"
+
+#include "encode.hpp"
+#include "sentence.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+	const char* err_trailing = "expected end of line after sentence";
+	const char* err_corrupt = "malformed binary sentence";
+
+	// The number of chunks to give each worker thread. Using more than one
+	// evens out the load when some parts of the file are harder to parse.
+	const std::size_t chunks_per_thread = 4;
+
+	// A chunk is a range of whole lines in the file, along with the results of
+	// parsing them. Line numbers are relative to the start of the chunk until
+	// the chunks are merged.
+	struct Chunk {
+		const char* _begin;
+		const char* _end;
+		std::vector<SentencePtr> _sentences;
+		std::vector<std::size_t> _lines;
+		std::vector<Diagnostic> _diagnostics;
+		std::size_t _lineCount;
+	};
+}
+
+// =============================================================================
+//            Parsing chunks
+// =============================================================================
+
+// Parses every line in the chunk using the given parser.
+static void parseChunk(Chunk& chunk, Parser& parser) {
+	const char* p = chunk._begin;
+	std::size_t line = 0;
+	while (p != chunk._end) {
+		const char* nl = static_cast<const char*>(
+			std::memchr(p, '\n', static_cast<std::size_t>(chunk._end - p)));
+		const char* eol = (nl == nullptr) ? chunk._end : nl;
+		++line;
+		Lexer lex(p, eol);
+		if (!lex.done()) {
+			ParseResult r = parser.parse(lex);
+			if (r._sentence == nullptr) {
+				chunk._diagnostics.push_back({line, r._position, r._error});
+			} else if (!lex.done()) {
+				chunk._diagnostics.push_back({line, lex.consumed(), err_trailing});
+			} else {
+				chunk._sentences.push_back(std::move(r._sentence));
+				chunk._lines.push_back(line);
+			}
+		}
+		p = (nl == nullptr) ? chunk._end : nl + 1;
+	}
+	chunk._lineCount = line;
+}
+
+// Splits the buffer into at most n chunks of roughly equal size. Each chunk
+// boundary is moved forward to the start of a line.
+static std::vector<Chunk> splitChunks(const char* data, std::size_t size,
+		std::size_t n) {
+	std::vector<Chunk> chunks;
+	const char* end = data + size;
+	const char* begin = data;
+	for (std::size_t k = 1; k <= n && begin != end; ++k) {
+		const char* stop = end;
+		if (k < n) {
+			const char* cut = std::max(begin, data + size * k / n);
+			const char* nl = static_cast<const char*>(
+				std::memchr(cut, '\n', static_cast<std::size_t>(end - cut)));
+			stop = (nl == nullptr) ? end : nl + 1;
+		}
+		chunks.push_back({begin, stop, {}, {}, {}, 0});
+		begin = stop;
+	}
+	return chunks;
+}
+
+// Parses all the chunks using a pool of worker threads. Each worker has its
+// own parser and repeatedly claims the next unparsed chunk.
+static void parseChunks(std::vector<Chunk>& chunks, unsigned int threads) {
+	std::atomic<std::size_t> next(0);
+	auto work = [&chunks, &next] {
+		Parser parser;
+		for (;;) {
+			std::size_t k = next++;
+			if (k >= chunks.size()) {
+				break;
+			}
+			parseChunk(chunks[k], parser);
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned int t = 1; t < threads; ++t) {
+		pool.emplace_back(work);
+	}
+	work();
+	for (std::thread& th: pool) {
+		th.join();
+	}
+}
+
+// =============================================================================
+//            Theorem file
+// =============================================================================
+
+TheoremFile::TheoremFile()
+	: _lineCount(0), _bytes(0), _threads(0), _seconds(0) {}
+
+TheoremFile::~TheoremFile() {
+	clear();
+}
+
+void TheoremFile::clear() {
+	_sentences.clear();
+	_lines.clear();
+	_diagnostics.clear();
+	_lineCount = 0;
+	_bytes = 0;
+	_threads = 0;
+	_seconds = 0;
+}
+
+bool TheoremFile::load(const char* path, unsigned int threads,
+		std::string& error) {
+	clear();
+	auto start = std::chrono::steady_clock::now();
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		error = std::strerror(errno);
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) == -1) {
+		error = std::strerror(errno);
+		close(fd);
+		return false;
+	}
+	std::size_t size = static_cast<std::size_t>(info.st_size);
+	const char* data = nullptr;
+	if (size > 0) {
+		void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED) {
+			error = std::strerror(errno);
+			close(fd);
+			return false;
+		}
+		data = static_cast<const char*>(map);
+	}
+	close(fd);
+	if (hasFlatMagic(data, size)) {
+		munmap(const_cast<char*>(data), size);
+		return loadFlat(path, error);
+	}
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	std::vector<Chunk> chunks =
+		splitChunks(data, size, threads * chunks_per_thread);
+	threads = std::min(threads, static_cast<unsigned int>(chunks.size()));
+	parseChunks(chunks, std::max(1u, threads));
+
+	// Merge the chunks in order, converting to absolute line numbers.
+	for (Chunk& c: chunks) {
+		for (std::size_t i = 0; i < c._sentences.size(); ++i) {
+			_sentences.push_back(std::move(c._sentences[i]));
+			_lines.push_back(_lineCount + c._lines[i]);
+		}
+		for (Diagnostic d: c._diagnostics) {
+			d._line += _lineCount;
+			_diagnostics.push_back(d);
+		}
+		_lineCount += c._lineCount;
+	}
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), size);
+	}
+	_bytes = size;
+	_threads = std::max(1u, threads);
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	_seconds = elapsed.count();
+	return true;
+}
+
+bool TheoremFile::loadFlat(const char* path, std::string& error) {
+	auto start = std::chrono::steady_clock::now();
+	FlatFile file;
+	if (!file.open(path, error)) {
+		return false;
+	}
+	_sentences.reserve(file.size());
+	_lines.reserve(file.size());
+	for (std::size_t i = 0; i < file.size(); ++i) {
+		SentencePtr s(file.decode(i));
+		if (s == nullptr) {
+			_diagnostics.push_back({i + 1, 0, err_corrupt});
+		} else {
+			_sentences.push_back(std::move(s));
+			_lines.push_back(i + 1);
+		}
+	}
+	struct stat info;
+	_bytes = stat(path, &info) == 0 ? static_cast<std::size_t>(info.st_size) : 0;
+	_lineCount = file.size();
+	_threads = 1;
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	_seconds = elapsed.count();
+	return true;
+}
+
+bool TheoremFile::save(const char* path, std::string& error) const {
+	Encoder e;
+	for (const SentencePtr& s: _sentences) {
+		e.add(*s);
+	}
+	return e.write(path, error);
+}
+
+void TheoremFile::printSummary(std::ostream& s) const {
+	s << "Loaded " << _sentences.size() << " sentence(s) from "
+		<< _lineCount << " line(s) (" << _bytes << " bytes) in "
+		<< _seconds * 1000 << " ms using " << _threads << " thread(s).\n";
+	if (_seconds > 0) {
+		s << "Throughput: " << static_cast<double>(_lineCount) / _seconds
+			<< " lines/s, " << static_cast<double>(_bytes) / _seconds / 1e6
+			<< " MB/s.\n";
+	}
+	if (!_diagnostics.empty()) {
+		s << _diagnostics.size() << " line(s) failed to parse.\n";
+	}
+}
+
+void TheoremFile::printDiagnostics(std::ostream& s) const {
+	for (const Diagnostic& d: _diagnostics) {
+		s << "line " << d._line << ", token " << d._position << ": "
+			<< d._error << '\n';
+	}
+}
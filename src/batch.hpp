@@ -0,0 +1,71 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "parse.hpp"
+#include "sentence.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A diagnostic records a line of a theorem file that could not be parsed.
+class Diagnostic {
+public:
+	std::size_t _line; // the line number, starting at 1
+	Index _position; // the token index of the error within the line
+	const char* _error; // the error message
+};
+
+// A theorem file is a library of sentences loaded from a text file that has
+// one sentence per line. Blank lines are skipped. It owns its sentences, which
+// appear in the same order as they do in the file.
+class TheoremFile {
+public:
+	TheoremFile();
+	~TheoremFile();
+
+	// Loads the sentences in the file at the given path, replacing whatever
+	// was loaded before. The file is memory-mapped, split into chunks of
+	// whole lines, and parsed by a pool of worker threads (or by as many as
+	// the hardware supports, if threads is zero). Returns false if the file
+	// could not be read, storing the reason in error. Lines that fail to parse
+	// are reported in the diagnostics rather than failing the whole load. If
+	// the file is a binary file written by save, its sentences are decoded
+	// instead of parsed, and each counts as one line.
+	bool load(const char* path, unsigned int threads, std::string& error);
+
+	// Saves the sentences to a binary file, which loads much faster than text
+	// because it needs no tokenizing or parsing. Returns false on failure,
+	// storing the reason in error.
+	bool save(const char* path, std::string& error) const;
+
+	// Deletes all the sentences and diagnostics.
+	void clear();
+
+	// Prints the number of sentences, lines, and bytes loaded, along with the
+	// time taken and the resulting throughput.
+	void printSummary(std::ostream& s) const;
+
+	// Prints each diagnostic on its own line.
+	void printDiagnostics(std::ostream& s) const;
+
+	std::vector<SentencePtr> _sentences; // the parsed sentences
+	std::vector<std::size_t> _lines; // the line number of each sentence
+	std::vector<Diagnostic> _diagnostics; // the lines that failed to parse
+	std::size_t _lineCount; // the total number of lines
+	std::size_t _bytes; // the size of the file
+	unsigned int _threads; // the number of worker threads used
+	double _seconds; // the time taken to load the file
+
+private:
+	// Loads the sentences from a binary file.
+	bool loadFlat(const char* path, std::string& error);
+
+	TheoremFile(const TheoremFile&) = delete;
+	TheoremFile& operator=(const TheoremFile&) = delete;
+};
+
+#endif
@@ -0,0 +1,375 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bitmap.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// The number of 64-bit words in a bitset container.
+	const std::size_t bitset_words = 1024;
+
+	// The largest array container. Beyond this, a bitset is smaller.
+	const std::size_t max_array = 4096;
+
+	// The operations that are done with word kernels.
+	enum Op { OR, AND, ANDNOT };
+
+	typedef Bitmap::Container Container;
+	typedef std::vector<std::uint16_t> Lows;
+	typedef std::vector<std::uint64_t> Words;
+}
+
+// =============================================================================
+//            Word kernels
+// =============================================================================
+
+// Combines two bitsets into dst, two words at a time when SSE2 is available.
+// Returns the number of bits set in the result.
+static std::uint32_t combineWords(Op op, const std::uint64_t* a,
+		const std::uint64_t* b, std::uint64_t* dst) {
+#if defined(__SSE2__)
+	for (std::size_t i = 0; i < bitset_words; i += 2) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		__m128i r = op == OR ? _mm_or_si128(va, vb)
+			: op == AND ? _mm_and_si128(va, vb)
+			: _mm_andnot_si128(vb, va);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), r);
+	}
+#else
+	for (std::size_t i = 0; i < bitset_words; ++i) {
+		switch (op) {
+		case OR: dst[i] = a[i] | b[i]; break;
+		case AND: dst[i] = a[i] & b[i]; break;
+		case ANDNOT: dst[i] = a[i] & ~b[i]; break;
+		}
+	}
+#endif
+	std::uint32_t n = 0;
+	for (std::size_t i = 0; i < bitset_words; ++i) {
+		n += static_cast<std::uint32_t>(__builtin_popcountll(dst[i]));
+	}
+	return n;
+}
+
+// =============================================================================
+//            Containers
+// =============================================================================
+
+// Returns true if the container has the low bits.
+static bool containerHas(const Container& c, std::uint16_t low) {
+	switch (c._kind) {
+	case Bitmap::ARRAY:
+		return std::binary_search(c._array.begin(), c._array.end(), low);
+	case Bitmap::BITSET:
+		return (c._bits[low >> 6] >> (low & 63)) & 1;
+	case Bitmap::RUN: {
+		// Find the last run starting at or before low.
+		std::size_t lo = 0;
+		std::size_t hi = c._array.size() / 2;
+		while (lo < hi) {
+			std::size_t mid = (lo + hi) / 2;
+			if (c._array[2 * mid] <= low) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo > 0 && low - c._array[2 * (lo - 1)] <= c._array[2 * lo - 1];
+	}
+	}
+	return false;
+}
+
+// Expands the container into a bitset.
+static void toWords(const Container& c, std::uint64_t* words) {
+	if (c._kind == Bitmap::BITSET) {
+		std::copy(c._bits.begin(), c._bits.end(), words);
+		return;
+	}
+	std::fill(words, words + bitset_words, 0);
+	if (c._kind == Bitmap::ARRAY) {
+		for (std::uint16_t low: c._array) {
+			words[low >> 6] |= static_cast<std::uint64_t>(1) << (low & 63);
+		}
+		return;
+	}
+	for (std::size_t i = 0; i < c._array.size(); i += 2) {
+		std::uint32_t end = c._array[i] + c._array[i + 1] + 1u;
+		for (std::uint32_t x = c._array[i]; x < end; ++x) {
+			words[x >> 6] |= static_cast<std::uint64_t>(1) << (x & 63);
+		}
+	}
+}
+
+// Appends the low bits of the container to out, in increasing order.
+static void toLows(const Container& c, Lows& out) {
+	switch (c._kind) {
+	case Bitmap::ARRAY:
+		out.insert(out.end(), c._array.begin(), c._array.end());
+		break;
+	case Bitmap::BITSET:
+		for (std::size_t i = 0; i < bitset_words; ++i) {
+			for (std::uint64_t w = c._bits[i]; w != 0; w &= w - 1) {
+				out.push_back(static_cast<std::uint16_t>(
+					i * 64 + static_cast<std::size_t>(__builtin_ctzll(w))));
+			}
+		}
+		break;
+	case Bitmap::RUN:
+		for (std::size_t i = 0; i < c._array.size(); i += 2) {
+			std::uint32_t end = c._array[i] + c._array[i + 1] + 1u;
+			for (std::uint32_t x = c._array[i]; x < end; ++x) {
+				out.push_back(static_cast<std::uint16_t>(x));
+			}
+		}
+		break;
+	}
+}
+
+// Creates a container from strictly increasing low bits, using whichever form
+// is smallest.
+static Container fromLows(std::uint16_t key, const std::uint16_t* lows,
+		std::size_t n) {
+	Container c;
+	c._key = key;
+	c._size = static_cast<std::uint32_t>(n);
+	std::size_t runs = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		if (i == 0 || lows[i] != lows[i - 1] + 1) {
+			++runs;
+		}
+	}
+	// Compare sizes in bytes: 4 per run, 2 per array value, 8192 for bitsets.
+	if (runs * 4 < std::min(n * 2, bitset_words * 8)) {
+		c._kind = Bitmap::RUN;
+		for (std::size_t i = 0; i < n; ++i) {
+			if (i == 0 || lows[i] != lows[i - 1] + 1) {
+				c._array.push_back(lows[i]);
+				c._array.push_back(0);
+			} else {
+				++c._array.back();
+			}
+		}
+	} else if (n <= max_array) {
+		c._kind = Bitmap::ARRAY;
+		c._array.assign(lows, lows + n);
+	} else {
+		c._kind = Bitmap::BITSET;
+		c._bits.assign(bitset_words, 0);
+		for (std::size_t i = 0; i < n; ++i) {
+			c._bits[lows[i] >> 6] |= static_cast<std::uint64_t>(1) << (lows[i] & 63);
+		}
+	}
+	return c;
+}
+
+// Creates a container from a bitset with n bits set, using whichever form is
+// smallest.
+static Container fromWords(std::uint16_t key, const std::uint64_t* words,
+		std::uint32_t n) {
+	Container c;
+	c._key = key;
+	c._kind = Bitmap::BITSET;
+	c._size = n;
+	c._bits.assign(words, words + bitset_words);
+	// Count the runs by counting the bits that start one.
+	std::size_t runs = 0;
+	std::uint64_t carry = 0;
+	for (std::size_t i = 0; i < bitset_words; ++i) {
+		std::uint64_t starts = words[i] & ~(words[i] << 1 | carry);
+		runs += static_cast<std::size_t>(__builtin_popcountll(starts));
+		carry = words[i] >> 63;
+	}
+	std::size_t size = n;
+	if (runs * 4 < std::min(size * 2, bitset_words * 8) || size <= max_array) {
+		Lows lows;
+		toLows(c, lows);
+		return fromLows(key, lows.data(), lows.size());
+	}
+	return c;
+}
+
+// Combines two containers with the same key. Returns false if the result is
+// empty. Small arrays are merged directly, and everything else is expanded
+// into bitsets and combined with a word kernel.
+static bool combine(Op op, const Container& a, const Container& b,
+		Container& out) {
+	if (a._kind == Bitmap::ARRAY && (b._kind == Bitmap::ARRAY || op != OR)) {
+		Lows lows;
+		switch (op) {
+		case OR:
+			std::set_union(a._array.begin(), a._array.end(),
+				b._array.begin(), b._array.end(), std::back_inserter(lows));
+			break;
+		case AND:
+			for (std::uint16_t low: a._array) {
+				if (containerHas(b, low)) {
+					lows.push_back(low);
+				}
+			}
+			break;
+		case ANDNOT:
+			for (std::uint16_t low: a._array) {
+				if (!containerHas(b, low)) {
+					lows.push_back(low);
+				}
+			}
+			break;
+		}
+		if (lows.empty()) {
+			return false;
+		}
+		out = fromLows(a._key, lows.data(), lows.size());
+		return true;
+	}
+	if (op == AND && b._kind == Bitmap::ARRAY) {
+		return combine(op, b, a, out);
+	}
+	Words wa(bitset_words), wb(bitset_words), wr(bitset_words);
+	toWords(a, wa.data());
+	toWords(b, wb.data());
+	std::uint32_t n = combineWords(op, wa.data(), wb.data(), wr.data());
+	if (n == 0) {
+		return false;
+	}
+	out = fromWords(a._key, wr.data(), n);
+	return true;
+}
+
+// =============================================================================
+//            Bitmap
+// =============================================================================
+
+Bitmap Bitmap::fromSorted(const std::uint32_t* values, std::size_t n) {
+	Bitmap b;
+	Lows lows;
+	std::size_t i = 0;
+	while (i < n) {
+		std::uint16_t key = static_cast<std::uint16_t>(values[i] >> 16);
+		lows.clear();
+		for (; i < n && values[i] >> 16 == key; ++i) {
+			lows.push_back(static_cast<std::uint16_t>(values[i]));
+		}
+		b._containers.push_back(fromLows(key, lows.data(), lows.size()));
+	}
+	b._size = n;
+	return b;
+}
+
+bool Bitmap::contains(std::uint32_t x) const {
+	std::uint16_t key = static_cast<std::uint16_t>(x >> 16);
+	auto iter = std::lower_bound(_containers.begin(), _containers.end(), key,
+		[](const Container& c, std::uint16_t k) { return c._key < k; });
+	return iter != _containers.end() && iter->_key == key
+		&& containerHas(*iter, static_cast<std::uint16_t>(x));
+}
+
+bool Bitmap::subsetOf(const Bitmap& other) const {
+	if (_size > other._size) {
+		return false;
+	}
+	std::size_t j = 0;
+	Container rest;
+	for (const Container& c: _containers) {
+		while (j < other._containers.size() && other._containers[j]._key < c._key) {
+			++j;
+		}
+		if (j == other._containers.size() || other._containers[j]._key != c._key
+				|| combine(ANDNOT, c, other._containers[j], rest)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Bitmap::values(std::vector<std::uint32_t>& out) const {
+	Lows lows;
+	for (const Container& c: _containers) {
+		lows.clear();
+		toLows(c, lows);
+		std::uint32_t high = static_cast<std::uint32_t>(c._key) << 16;
+		for (std::uint16_t low: lows) {
+			out.push_back(high | low);
+		}
+	}
+}
+
+std::size_t Bitmap::count(Kind kind) const {
+	std::size_t n = 0;
+	for (const Container& c: _containers) {
+		n += c._kind == kind;
+	}
+	return n;
+}
+
+// Merges the containers of two bitmaps by key. Containers with a key in only
+// one bitmap are copied if the corresponding flag is set.
+static void merge(Op op, const NodeVec<Container>& a,
+		const NodeVec<Container>& b, bool keepA, bool keepB,
+		NodeVec<Container>& out, std::size_t& size) {
+	std::size_t i = 0, j = 0;
+	Container c;
+	while (i < a.size() || j < b.size()) {
+		if (j == b.size() || (i < a.size() && a[i]._key < b[j]._key)) {
+			if (keepA) {
+				out.push_back(a[i]);
+				size += a[i]._size;
+			}
+			++i;
+		} else if (i == a.size() || b[j]._key < a[i]._key) {
+			if (keepB) {
+				out.push_back(b[j]);
+				size += b[j]._size;
+			}
+			++j;
+		} else {
+			if (combine(op, a[i], b[j], c)) {
+				size += c._size;
+				out.push_back(std::move(c));
+			}
+			++i;
+			++j;
+		}
+	}
+}
+
+Bitmap Bitmap::unite(const Bitmap& a, const Bitmap& b) {
+	Bitmap r;
+	merge(OR, a._containers, b._containers, true, true, r._containers, r._size);
+	return r;
+}
+
+Bitmap Bitmap::intersect(const Bitmap& a, const Bitmap& b) {
+	Bitmap r;
+	merge(AND, a._containers, b._containers, false, false, r._containers,
+		r._size);
+	return r;
+}
+
+Bitmap Bitmap::subtract(const Bitmap& a, const Bitmap& b) {
+	Bitmap r;
+	merge(ANDNOT, a._containers, b._containers, true, false, r._containers,
+		r._size);
+	return r;
+}
+
+bool operator==(const Bitmap& a, const Bitmap& b) {
+	if (a._size != b._size || a._containers.size() != b._containers.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i < a._containers.size(); ++i) {
+		const Container& x = a._containers[i];
+		const Container& y = b._containers[i];
+		if (x._key != y._key || x._kind != y._kind || x._size != y._size
+				|| x._array != y._array || x._bits != y._bits) {
+			return false;
+		}
+	}
+	return true;
+}
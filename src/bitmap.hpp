@@ -0,0 +1,68 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include "arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A bitmap is a compressed set of 32-bit unsigned integers, in the style of
+// Roaring bitmaps. Values are grouped by their high 16 bits into containers,
+// and each container stores its low 16 bits in whichever of three forms is
+// smallest: a sorted array, a 65536-bit bitset, or a list of runs. The form
+// depends only on the contents, so equal bitmaps have identical containers.
+// Set operations work container by container, using SSE2 word kernels when
+// both sides are (or are expanded to) bitsets.
+class Bitmap {
+public:
+	// The ways a container can store its values.
+	enum Kind : std::uint8_t { ARRAY, BITSET, RUN };
+
+	Bitmap() : _size(0) {}
+
+	// Creates a bitmap from strictly increasing values.
+	static Bitmap fromSorted(const std::uint32_t* values, std::size_t n);
+
+	// Returns the number of values.
+	std::size_t size() const { return _size; }
+
+	// Returns true if the bitmap contains the value.
+	bool contains(std::uint32_t x) const;
+
+	// Returns true if every value in this bitmap is also in the other.
+	bool subsetOf(const Bitmap& other) const;
+
+	// Appends the values to out, in increasing order.
+	void values(std::vector<std::uint32_t>& out) const;
+
+	// Returns the number of containers of the given kind.
+	std::size_t count(Kind kind) const;
+
+	// Returns the union, intersection, or difference of two bitmaps.
+	static Bitmap unite(const Bitmap& a, const Bitmap& b);
+	static Bitmap intersect(const Bitmap& a, const Bitmap& b);
+	static Bitmap subtract(const Bitmap& a, const Bitmap& b);
+
+	friend bool operator==(const Bitmap& a, const Bitmap& b);
+
+	// A container holds the values that share the high 16 bits given by its
+	// key. Arrays keep the sorted low bits in _array, runs keep pairs of start
+	// and length minus one in _array, and bitsets keep 1024 words in _bits.
+	class Container {
+	public:
+		std::uint16_t _key; // the high 16 bits
+		Kind _kind; // the storage form
+		std::uint32_t _size; // the number of values, from 1 to 65536
+		NodeVec<std::uint16_t> _array; // the array or run data
+		NodeVec<std::uint64_t> _bits; // the bitset words
+	};
+
+private:
+	NodeVec<Container> _containers; // the containers, sorted by key
+	std::size_t _size; // the total number of values
+};
+
+#endif
@@ -0,0 +1,289 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "dag.hpp"
+
+#include "hash.hpp"
+#include "sentence.hpp"
+
+#include <cassert>
+
+// =============================================================================
+//            DagRef
+// =============================================================================
+
+DagRef::DagRef(const DagRef& other) : _dag(other._dag), _node(other._node) {
+	if (_node != nullptr) {
+		++_node->_refs;
+	}
+}
+
+DagRef& DagRef::operator=(const DagRef& other) {
+	if (other._node != nullptr) {
+		++other._node->_refs;
+	}
+	if (_node != nullptr) {
+		_dag->release(_node);
+	}
+	_dag = other._dag;
+	_node = other._node;
+	return *this;
+}
+
+DagRef::~DagRef() {
+	if (_node != nullptr) {
+		_dag->release(_node);
+	}
+}
+
+DagRef DagRef::operator[](std::size_t i) const {
+	DagNode* kid = _node->_kids[i];
+	++kid->_refs;
+	return DagRef(_dag, kid);
+}
+
+// =============================================================================
+//            Dag
+// =============================================================================
+
+Dag::~Dag() {
+	for (DagNode* n: _nodes) {
+		delete n;
+	}
+}
+
+// The variable of a quantifier is only a name, so it is not compared.
+bool Dag::Equal::operator()(const DagNode* a, const DagNode* b) const {
+	return a->_hash == b->_hash && a->_tag == b->_tag
+		&& a->_type == b->_type && a->_flag == b->_flag
+		&& (a->_tag == FLAT_QUANTIFIED
+			|| (a->_payload == b->_payload && a->_name == b->_name))
+		&& a->_kids == b->_kids;
+}
+
+DagNode* Dag::find(DagNode& key) {
+	std::uint64_t h = hashMix(0, static_cast<std::uint64_t>(key._tag)
+		| static_cast<std::uint64_t>(key._type) << 8
+		| static_cast<std::uint64_t>(key._flag) << 16);
+	if (key._tag != FLAT_QUANTIFIED) {
+		h = hashMix(h, key._payload);
+		h = hashMix(h, key._name);
+	}
+	for (const DagNode* kid: key._kids) {
+		h = hashMix(h, kid->_hash);
+	}
+	key._hash = h;
+	auto iter = _nodes.find(&key);
+	if (iter != _nodes.end()) {
+		// The existing node already holds its own operand references.
+		for (DagNode* kid: key._kids) {
+			release(kid);
+		}
+		++(*iter)->_refs;
+		return *iter;
+	}
+	DagNode* node = new DagNode(key);
+	node->_refs = 1;
+	_nodes.insert(node);
+	return node;
+}
+
+void Dag::release(DagNode* node) {
+	assert(node->_refs > 0);
+	if (--node->_refs == 0) {
+		_nodes.erase(node);
+		for (DagNode* kid: node->_kids) {
+			release(kid);
+		}
+		delete node;
+	}
+}
+
+DagRef Dag::make(FlatTag tag, int type, bool flag, std::uint32_t payload,
+		const std::vector<DagRef>& kids) {
+	assert(tag != FLAT_QUANTIFIED);
+	DagNode key;
+	key._tag = tag;
+	key._type = static_cast<std::uint8_t>(type);
+	key._flag = flag;
+	key._payload = payload;
+	key._name = 0;
+	key._kids.reserve(kids.size());
+	for (const DagRef& k: kids) {
+		assert(k._dag == this);
+		++k._node->_refs;
+		key._kids.push_back(k._node);
+	}
+	return DagRef(this, find(key));
+}
+
+DagRef Dag::symbol(unsigned int name, unsigned int id) {
+	DagNode key;
+	key._tag = FLAT_SYMBOL;
+	key._type = 0;
+	key._flag = 0;
+	key._payload = id;
+	key._name = name;
+	return DagRef(this, find(key));
+}
+
+DagRef Dag::intern(const Sentence& s) {
+	Encoder e;
+	e.add(s);
+	return intern(e.code()).front();
+}
+
+// Returns the number of operands of a flat node.
+static std::size_t arity(const FlatNode& n) {
+	switch (n._tag) {
+	case FLAT_NUMBER:
+	case FLAT_SPECIAL_SET:
+	case FLAT_SYMBOL:
+	case FLAT_LIMB:
+		return 0;
+	case FLAT_CONCRETE_SET:
+	case FLAT_BIG_NUMBER:
+		return n._payload;
+	case FLAT_RANGE_SET:
+		return 2 * static_cast<std::size_t>(n._payload);
+	default:
+		return 2;
+	}
+}
+
+// Marks the nodes of the sentence that are the variables of quantifiers. The
+// variable is the first node of the quantifier's operands.
+static std::vector<bool> findVariables(const FlatNode* begin,
+		const FlatNode* end) {
+	std::vector<bool> vars(static_cast<std::size_t>(end - begin), false);
+	std::vector<std::size_t> starts;
+	for (std::size_t p = 0; p < vars.size(); ++p) {
+		std::size_t k = arity(begin[p]);
+		assert(k <= starts.size());
+		std::size_t start = k == 0 ? p : starts[starts.size() - k];
+		starts.resize(starts.size() - k);
+		starts.push_back(start);
+		if (begin[p]._tag == FLAT_QUANTIFIED) {
+			vars[start] = true;
+		}
+	}
+	return vars;
+}
+
+std::vector<DagRef> Dag::intern(const FlatCode& code) {
+	std::vector<DagRef> roots;
+	roots.reserve(code.size());
+	std::vector<DagNode*> stack;
+	std::vector<std::uint32_t> binders; // the bindings of the variables
+	for (std::size_t i = 0; i < code.size(); ++i) {
+		const FlatNode* begin = code.begin(i);
+		std::vector<bool> vars = findVariables(begin, code.end(i));
+		for (const FlatNode* n = begin; n != code.end(i); ++n) {
+			// A variable gets no node of its own. It stays on the stack as null
+			// until its quantifier takes its binding.
+			if (vars[static_cast<std::size_t>(n - begin)]) {
+				binders.push_back(n->_payload);
+				stack.push_back(nullptr);
+				continue;
+			}
+			DagNode key;
+			key._tag = n->_tag;
+			key._type = n->_type;
+			key._flag = n->_flag;
+			key._payload = n->_payload;
+			key._name = 0;
+			if (n->_tag == FLAT_SYMBOL && n->_flag) {
+				// The nearest variable with the same binding is the binder.
+				std::size_t j = binders.size();
+				while (j > 0 && binders[j - 1] != n->_payload) {
+					--j;
+				}
+				assert(j > 0);
+				key._payload = static_cast<std::uint32_t>(binders.size() - j + 1);
+			} else if (n->_tag == FLAT_SYMBOL) {
+				key._payload = code._ids[n->_payload];
+				key._name = code._names[n->_payload];
+			} else if (n->_tag == FLAT_QUANTIFIED) {
+				key._payload = code._ids[binders.back()];
+				key._name = code._names[binders.back()];
+				binders.pop_back();
+				assert(stack.size() >= 2 && stack[stack.size() - 2] == nullptr);
+				stack.erase(stack.end() - 2);
+				key._kids.push_back(stack.back());
+				stack.pop_back();
+				stack.push_back(find(key));
+				continue;
+			}
+			std::size_t k = arity(*n);
+			assert(k <= stack.size());
+			key._kids.assign(stack.end() - static_cast<std::ptrdiff_t>(k),
+				stack.end());
+			stack.resize(stack.size() - k);
+			stack.push_back(find(key));
+		}
+		assert(stack.size() == 1);
+		roots.push_back(DagRef(this, stack.back()));
+		stack.clear();
+	}
+	return roots;
+}
+
+// Returns the binding index for the symbol, assigning a new one if this is the
+// first time the identifier has been seen.
+static std::uint32_t bind(unsigned int name, unsigned int id, FlatCode& code,
+		std::unordered_map<unsigned int, std::uint32_t>& bindings) {
+	std::uint32_t index = static_cast<std::uint32_t>(code._ids.size());
+	auto result = bindings.emplace(id, index);
+	if (result.second) {
+		code._names.push_back(name);
+		code._ids.push_back(id);
+	}
+	return result.first->second;
+}
+
+// Appends a flat node to the code.
+static void append(FlatCode& code, const DagNode* n, std::uint32_t payload) {
+	FlatNode f;
+	f._tag = n->_tag;
+	f._type = n->_type;
+	f._flag = n->_flag;
+	f._unused = 0;
+	f._payload = payload;
+	code._nodes.push_back(f);
+}
+
+// Appends the flat encoding of the node to the code, assigning bindings to
+// symbols by identifier. The binders are the bindings of the variables of the
+// enclosing quantifiers, innermost last.
+static void flatten(const DagNode* n, FlatCode& code,
+		std::unordered_map<unsigned int, std::uint32_t>& bindings,
+		std::vector<std::uint32_t>& binders) {
+	if (n->_tag == FLAT_QUANTIFIED) {
+		std::uint32_t var = bind(n->_name, n->_payload, code, bindings);
+		FlatNode f = {FLAT_SYMBOL, 0, 0, 0, var};
+		code._nodes.push_back(f);
+		binders.push_back(var);
+		flatten(n->_kids[0], code, bindings, binders);
+		binders.pop_back();
+		append(code, n, 0);
+		return;
+	}
+	for (const DagNode* kid: n->_kids) {
+		flatten(kid, code, bindings, binders);
+	}
+	std::uint32_t payload = n->_payload;
+	if (n->_tag == FLAT_SYMBOL && n->_flag) {
+		payload = binders[binders.size() - n->_payload];
+	} else if (n->_tag == FLAT_SYMBOL) {
+		payload = bind(n->_name, n->_payload, code, bindings);
+	}
+	append(code, n, payload);
+}
+
+Sentence* Dag::expand(const DagRef& r) const {
+	FlatCode code;
+	std::unordered_map<unsigned int, std::uint32_t> bindings;
+	std::vector<std::uint32_t> binders;
+	flatten(r._node, code, bindings, binders);
+	code._ends.push_back(static_cast<std::uint32_t>(code._nodes.size()));
+	return code.decode(0);
+}
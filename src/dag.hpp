@@ -0,0 +1,138 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef DAG_H
+#define DAG_H
+
+#include "encode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+class Dag;
+class Sentence;
+
+// A DAG node is an immutable, hash-consed sentence or object node. Within one
+// DAG there is never more than one node with a given structure, so subterms
+// that appear many times are stored once and shared. Nodes are reference
+// counted, and a node is deleted when nothing refers to it any more.
+//
+// Structure is the same as for Sentence::equal, so bound variables are compared
+// by index. A bound symbol's payload is its index (see Symbol), and a
+// quantifier's only operand is its body. The quantifier's payload and name are
+// the identifier and name of its variable, but they are not part of its
+// structure: alpha-equivalent sentences share nodes, and expanding them uses
+// the names of the one interned first.
+class DagNode {
+public:
+	std::uint8_t _tag; // a FlatTag
+	std::uint8_t _type; // the type enumerator
+	std::uint8_t _flag; // 0 or 1
+	std::uint32_t _payload; // the integer, element count, symbol identifier,
+	                        // or de Bruijn index
+	unsigned int _name; // the interned name, for free symbols and quantifiers
+	std::uint64_t _hash; // the structural hash
+	std::vector<DagNode*> _kids; // the operands, in order
+	std::size_t _refs; // the number of references to this node
+};
+
+// A DAG reference is a counted handle to a node. Copying one is a reference
+// count bump rather than a deep copy, and two references are equal exactly
+// when they are structurally equal, because both point to the same node.
+class DagRef {
+public:
+	DagRef() : _dag(nullptr), _node(nullptr) {}
+	DagRef(const DagRef& other);
+	DagRef& operator=(const DagRef& other);
+	~DagRef();
+
+	// Returns true if this refers to a node.
+	explicit operator bool() const { return _node != nullptr; }
+
+	// Returns the node.
+	const DagNode& operator*() const { return *_node; }
+	const DagNode* operator->() const { return _node; }
+
+	// Returns the number of operands, or operand i.
+	std::size_t size() const { return _node->_kids.size(); }
+	DagRef operator[](std::size_t i) const;
+
+	friend bool operator==(const DagRef& a, const DagRef& b) {
+		return a._node == b._node;
+	}
+	friend bool operator!=(const DagRef& a, const DagRef& b) {
+		return a._node != b._node;
+	}
+
+private:
+	friend class Dag;
+
+	// Wraps a node whose reference has already been counted.
+	DagRef(Dag* dag, DagNode* node) : _dag(dag), _node(node) {}
+
+	Dag* _dag; // the DAG that owns the node
+	DagNode* _node; // the node, or null
+};
+
+// A DAG is a table of hash-consed nodes. Sentences can be interned into it and
+// expanded back out of it, and new nodes can be built from existing ones. It
+// is an opt-in alternative to the ordinary tree representation for when many
+// copies of the same subterms would otherwise be made. It is not thread-safe,
+// and it must outlive all references to its nodes.
+class Dag {
+public:
+	Dag() {}
+	~Dag();
+
+	// Interns a sentence, returning a reference to its root.
+	DagRef intern(const Sentence& s);
+
+	// Interns every sentence in the flat code, returning their roots.
+	std::vector<DagRef> intern(const FlatCode& code);
+
+	// Returns the node with the given structure, creating it if necessary.
+	// The operands must belong to this DAG. Quantifiers can only be interned,
+	// since their bodies have to refer to the variable by index.
+	DagRef make(FlatTag tag, int type, bool flag, std::uint32_t payload,
+		const std::vector<DagRef>& kids);
+
+	// Returns the node for the free symbol with the given name and identifier.
+	DagRef symbol(unsigned int name, unsigned int id);
+
+	// Expands a sentence node into a new tree. Shared nodes are copied once
+	// for every place they appear, and symbols keep their identifiers.
+	Sentence* expand(const DagRef& r) const;
+
+	// Returns the number of distinct nodes in the DAG.
+	std::size_t size() const { return _nodes.size(); }
+
+private:
+	friend class DagRef;
+
+	Dag(const Dag&) = delete;
+	Dag& operator=(const Dag&) = delete;
+
+	// Returns the node with the same structure as the key, creating it if
+	// necessary. Takes over one reference to each of the key's operands, and
+	// returns one new reference to the node.
+	DagNode* find(DagNode& key);
+
+	// Drops one reference to the node, deleting it if it was the last.
+	void release(DagNode* node);
+
+	// Hashes and compares nodes by structure. Operands are compared by
+	// pointer, since they are already unique.
+	struct Hash {
+		std::size_t operator()(const DagNode* n) const {
+			return static_cast<std::size_t>(n->_hash);
+		}
+	};
+	struct Equal {
+		bool operator()(const DagNode* a, const DagNode* b) const;
+	};
+
+	std::unordered_set<DagNode*, Hash, Equal> _nodes; // all the live nodes
+};
+
+#endif
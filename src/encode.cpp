@@ -0,0 +1,486 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "encode.hpp"
+
+#include "object.hpp"
+#include "sentence.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A binary file consists of a header followed by five arrays:
+//
+//     std::uint32_t ends[sentences];  // the end of each sentence in nodes
+//     FlatNode nodes[nodes];          // the nodes of all the sentences
+//     std::uint32_t bindings[bindings]; // the name index of each binding
+//     std::uint32_t names[names];     // the end of each name in chars
+//     char chars[chars];              // the bytes of all the names
+//
+// Every field is written in the byte order of the machine that wrote it. The
+// order field lets the reader reject files written on a different machine.
+
+namespace {
+	const char flat_magic[8] = {'S', 'P', 'A', 'F', 'L', 'A', 'T', '\0'};
+	const std::uint32_t flat_order = 0x01020304;
+
+	struct Header {
+		char _magic[8];
+		std::uint32_t _version;
+		std::uint32_t _order;
+		std::uint32_t _sentences;
+		std::uint32_t _nodes;
+		std::uint32_t _bindings;
+		std::uint32_t _names;
+		std::uint32_t _chars;
+		std::uint32_t _unused;
+	};
+
+	const char* err_magic = "not a binary sentence file";
+	const char* err_version = "unsupported binary format version";
+	const char* err_order = "binary file has the wrong byte order";
+	const char* err_truncated = "binary file is truncated";
+	const char* err_corrupt = "binary file is corrupt";
+}
+
+static_assert(sizeof(FlatNode) == 8, "flat nodes must be packed");
+
+// =============================================================================
+//            Decoding
+// =============================================================================
+
+// The largest type enumerator for each tag.
+static int maxType(std::uint8_t tag) {
+	switch (tag) {
+	case FLAT_NUMBER: return 0;
+	case FLAT_COMPOUND_NUMBER: return CompoundNumber::MUL;
+	case FLAT_CONCRETE_SET: return 0;
+	case FLAT_SPECIAL_SET: return SpecialSet::SETS;
+	case FLAT_COMPOUND_SET: return CompoundSet::DIFF;
+	case FLAT_SYMBOL: return 0;
+	case FLAT_LOGICAL: return Logical::IFF;
+	case FLAT_RELATION: return Relation::DIV;
+	case FLAT_QUANTIFIED: return Quantified::EXISTS;
+	case FLAT_LIMB: return 0;
+	case FLAT_BIG_NUMBER: return 0;
+	case FLAT_RANGE_SET: return 0;
+	default: return -1;
+	}
+}
+
+Sentence* decodeFlat(const FlatNode* begin, const FlatNode* end,
+		const std::vector<unsigned int>& names,
+		const std::vector<unsigned int>* ids) {
+	std::vector<Object*> objects;
+	std::vector<Sentence*> sentences;
+	std::vector<std::uint32_t> limbs;
+	std::unordered_map<std::uint32_t, Symbol*> symbols;
+	SymMap symbolMap;
+	bool ok = true;
+	for (const FlatNode* n = begin; ok && n != end; ++n) {
+		if (n->_type > maxType(n->_tag) || n->_flag > 1) {
+			ok = false;
+			break;
+		}
+		switch (n->_tag) {
+		case FLAT_NUMBER:
+			objects.push_back(new ConcreteNumber(
+				static_cast<int>(static_cast<std::int32_t>(n->_payload))));
+			break;
+		case FLAT_LIMB:
+			limbs.push_back(n->_payload);
+			break;
+		case FLAT_BIG_NUMBER: {
+			if (n->_payload > limbs.size()) {
+				ok = false;
+				break;
+			}
+			std::size_t first = limbs.size() - n->_payload;
+			objects.push_back(new ConcreteNumber(Integer::fromMagnitude(
+				limbs.data() + first, n->_payload, n->_flag)));
+			limbs.resize(first);
+			break;
+		}
+		case FLAT_SPECIAL_SET:
+			objects.push_back(new SpecialSet(
+				static_cast<SpecialSet::Type>(n->_type)));
+			break;
+		case FLAT_SYMBOL: {
+			if (n->_payload >= names.size()) {
+				ok = false;
+				break;
+			}
+			// The first occurrence of each binding gets its identifier, and the
+			// rest are clones of it so that they share that identifier.
+			auto iter = symbols.find(n->_payload);
+			if (iter == symbols.end()) {
+				unsigned int name = names[n->_payload];
+				bool fresh = ids == nullptr;
+				if (!fresh) {
+					symbolMap.bind(name, (*ids)[n->_payload]);
+				}
+				Symbol* sym = new Symbol(name, symbolMap, fresh);
+				symbols.emplace(n->_payload, sym);
+				objects.push_back(sym);
+			} else {
+				objects.push_back(iter->second->cloneSelf());
+			}
+			break;
+		}
+		case FLAT_CONCRETE_SET: {
+			if (n->_payload > objects.size()) {
+				ok = false;
+				break;
+			}
+			auto first = objects.end() - static_cast<std::ptrdiff_t>(n->_payload);
+			std::vector<Object*> items(first, objects.end());
+			objects.erase(first, objects.end());
+			objects.push_back(new ConcreteSet(items));
+			break;
+		}
+		case FLAT_RANGE_SET: {
+			std::size_t count = 2 * static_cast<std::size_t>(n->_payload);
+			if (count > objects.size()) {
+				ok = false;
+				break;
+			}
+			auto first = objects.end() - static_cast<std::ptrdiff_t>(count);
+			std::vector<RangeSet::Interval> intervals;
+			long long bounds[2];
+			for (auto iter = first; ok && iter != objects.end(); iter += 2) {
+				for (int k = 0; k < 2; ++k) {
+					auto num = objectCast<ConcreteNumber>(iter[k]);
+					ok = ok && num != nullptr && num->value().isSmall();
+					bounds[k] = ok ? num->value().small() : 0;
+				}
+				intervals.emplace_back(bounds[0], bounds[1]);
+			}
+			for (auto iter = first; iter != objects.end(); ++iter) {
+				delete *iter;
+			}
+			objects.erase(first, objects.end());
+			if (ok) {
+				objects.push_back(new RangeSet(intervals));
+			}
+			break;
+		}
+		case FLAT_COMPOUND_NUMBER:
+		case FLAT_COMPOUND_SET:
+		case FLAT_RELATION: {
+			if (objects.size() < 2) {
+				ok = false;
+				break;
+			}
+			Object* a = objects[objects.size() - 2];
+			Object* b = objects[objects.size() - 1];
+			Object* result = nullptr;
+			if (n->_tag == FLAT_RELATION) {
+				sentences.push_back(new Relation(
+					static_cast<Relation::Type>(n->_type), n->_flag, a, b));
+			} else if (n->_tag == FLAT_COMPOUND_NUMBER) {
+				if (!a->isNumber() || !b->isNumber()) {
+					ok = false;
+					break;
+				}
+				result = new CompoundNumber(
+					static_cast<CompoundNumber::Type>(n->_type), a, b);
+			} else {
+				if (!a->isSet() || !b->isSet()) {
+					ok = false;
+					break;
+				}
+				result = new CompoundSet(
+					static_cast<CompoundSet::Type>(n->_type), a, b);
+			}
+			objects.pop_back();
+			objects.pop_back();
+			if (result != nullptr) {
+				objects.push_back(result);
+			}
+			break;
+		}
+		case FLAT_LOGICAL: {
+			if (sentences.size() < 2) {
+				ok = false;
+				break;
+			}
+			Sentence* b = sentences.back();
+			sentences.pop_back();
+			Sentence* a = sentences.back();
+			sentences.back() = new Logical(
+				static_cast<Logical::Type>(n->_type), a, b);
+			break;
+		}
+		case FLAT_QUANTIFIED: {
+			Symbol* var = objects.empty()
+				? nullptr : objectCast<Symbol>(objects.back());
+			if (var == nullptr || sentences.empty()) {
+				ok = false;
+				break;
+			}
+			objects.pop_back();
+			// The occurrences of the variable in the body were decoded as free
+			// symbols with its identifier, and the constructor binds them.
+			sentences.back() = new Quantified(
+				static_cast<Quantified::Type>(n->_type), var, sentences.back());
+			break;
+		}
+		default:
+			ok = false;
+			break;
+		}
+	}
+	if (ok && sentences.size() == 1 && objects.empty() && limbs.empty()) {
+		return sentences.back();
+	}
+	for (Object* obj: objects) {
+		delete obj;
+	}
+	for (Sentence* s: sentences) {
+		delete s;
+	}
+	return nullptr;
+}
+
+bool hasFlatMagic(const char* data, std::size_t size) {
+	return size >= sizeof flat_magic
+		&& std::memcmp(data, flat_magic, sizeof flat_magic) == 0;
+}
+
+// =============================================================================
+//            FlatCode
+// =============================================================================
+
+const FlatNode* FlatCode::begin(std::size_t i) const {
+	return _nodes.data() + (i == 0 ? 0 : _ends[i - 1]);
+}
+
+const FlatNode* FlatCode::end(std::size_t i) const {
+	return _nodes.data() + _ends[i];
+}
+
+Sentence* FlatCode::decode(std::size_t i) const {
+	return decodeFlat(begin(i), end(i), _names, &_ids);
+}
+
+// =============================================================================
+//            Encoder
+// =============================================================================
+
+void Encoder::add(const Sentence& s) {
+	s.encode(*this);
+	_code._ends.push_back(static_cast<std::uint32_t>(_code._nodes.size()));
+}
+
+void Encoder::node(FlatTag tag, int type, bool flag, std::uint32_t payload) {
+	FlatNode n;
+	n._tag = tag;
+	n._type = static_cast<std::uint8_t>(type);
+	n._flag = flag;
+	n._unused = 0;
+	n._payload = payload;
+	_code._nodes.push_back(n);
+}
+
+std::uint32_t Encoder::binding(unsigned int name, unsigned int id) {
+	std::uint32_t index = static_cast<std::uint32_t>(_code._names.size());
+	auto result = _bindings.emplace(id, index);
+	if (result.second) {
+		_code._names.push_back(name);
+		_code._ids.push_back(id);
+	}
+	return result.first->second;
+}
+
+// Writes the bytes of a vector to the file.
+template <typename T>
+static void writeArray(std::FILE* file, const std::vector<T>& v) {
+	if (!v.empty()) {
+		std::fwrite(v.data(), sizeof(T), v.size(), file);
+	}
+}
+
+bool Encoder::write(const char* path, std::string& error) const {
+	// Store each distinct name once, even if several bindings share it.
+	std::unordered_map<unsigned int, std::uint32_t> nameIndex;
+	std::vector<std::uint32_t> bindings;
+	std::vector<std::uint32_t> nameEnds;
+	std::vector<char> chars;
+	bindings.reserve(_code._names.size());
+	for (unsigned int name: _code._names) {
+		std::uint32_t index = static_cast<std::uint32_t>(nameEnds.size());
+		auto result = nameIndex.emplace(name, index);
+		if (result.second) {
+			const std::string& str = nameString(name);
+			chars.insert(chars.end(), str.begin(), str.end());
+			nameEnds.push_back(static_cast<std::uint32_t>(chars.size()));
+		}
+		bindings.push_back(result.first->second);
+	}
+
+	Header h;
+	std::memcpy(h._magic, flat_magic, sizeof flat_magic);
+	h._version = flat_version;
+	h._order = flat_order;
+	h._sentences = static_cast<std::uint32_t>(_code._ends.size());
+	h._nodes = static_cast<std::uint32_t>(_code._nodes.size());
+	h._bindings = static_cast<std::uint32_t>(bindings.size());
+	h._names = static_cast<std::uint32_t>(nameEnds.size());
+	h._chars = static_cast<std::uint32_t>(chars.size());
+	h._unused = 0;
+
+	std::FILE* file = std::fopen(path, "wb");
+	if (file == nullptr) {
+		error = std::strerror(errno);
+		return false;
+	}
+	std::fwrite(&h, sizeof h, 1, file);
+	writeArray(file, _code._ends);
+	writeArray(file, _code._nodes);
+	writeArray(file, bindings);
+	writeArray(file, nameEnds);
+	writeArray(file, chars);
+	bool failed = std::ferror(file) != 0;
+	if (std::fclose(file) != 0 || failed) {
+		error = std::strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+// =============================================================================
+//            FlatFile
+// =============================================================================
+
+FlatFile::FlatFile()
+	: _map(nullptr), _mapSize(0), _count(0), _ends(nullptr), _nodes(nullptr),
+	_nodeCount(0) {}
+
+FlatFile::~FlatFile() {
+	close();
+}
+
+void FlatFile::close() {
+	if (_map != nullptr) {
+		munmap(_map, _mapSize);
+	}
+	_map = nullptr;
+	_mapSize = 0;
+	_count = 0;
+	_ends = nullptr;
+	_nodes = nullptr;
+	_nodeCount = 0;
+	_names.clear();
+}
+
+bool FlatFile::open(const char* path, std::string& error) {
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if (fd == -1) {
+		error = std::strerror(errno);
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) == -1) {
+		error = std::strerror(errno);
+		::close(fd);
+		return false;
+	}
+	std::size_t size = static_cast<std::size_t>(info.st_size);
+	if (size < sizeof flat_magic) {
+		::close(fd);
+		error = err_magic;
+		return false;
+	}
+	void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		error = std::strerror(errno);
+		return false;
+	}
+	_map = map;
+	_mapSize = size;
+
+	const char* data = static_cast<const char*>(map);
+	const Header* h = static_cast<const Header*>(map);
+	const char* problem = nullptr;
+	if (std::memcmp(data, flat_magic, sizeof flat_magic) != 0) {
+		problem = err_magic;
+	} else if (size < sizeof(Header)) {
+		problem = err_truncated;
+	} else if (h->_order != flat_order) {
+		problem = err_order;
+	} else if (h->_version != flat_version) {
+		problem = err_version;
+	} else {
+		// Compute the offset of each array in 64 bits to avoid overflow.
+		unsigned long long ends = sizeof(Header);
+		unsigned long long nodes = ends + 4ull * h->_sentences;
+		unsigned long long bindings = nodes + sizeof(FlatNode) * h->_nodes;
+		unsigned long long names = bindings + 4ull * h->_bindings;
+		unsigned long long chars = names + 4ull * h->_names;
+		if (chars + h->_chars > size) {
+			problem = err_truncated;
+		} else {
+			_count = h->_sentences;
+			_ends = reinterpret_cast<const std::uint32_t*>(data + ends);
+			_nodes = reinterpret_cast<const FlatNode*>(data + nodes);
+			_nodeCount = h->_nodes;
+			const std::uint32_t* bind =
+				reinterpret_cast<const std::uint32_t*>(data + bindings);
+			const std::uint32_t* nameEnds =
+				reinterpret_cast<const std::uint32_t*>(data + names);
+			const char* str = data + chars;
+
+			// Intern the names once, so that decoding is just array lookups.
+			std::vector<unsigned int> interned(h->_names);
+			std::uint32_t prev = 0;
+			for (std::uint32_t i = 0; !problem && i < h->_names; ++i) {
+				if (nameEnds[i] < prev || nameEnds[i] > h->_chars) {
+					problem = err_corrupt;
+				} else {
+					interned[i] = internName(str + prev, nameEnds[i] - prev);
+					prev = nameEnds[i];
+				}
+			}
+			_names.reserve(h->_bindings);
+			for (std::uint32_t i = 0; !problem && i < h->_bindings; ++i) {
+				if (bind[i] >= h->_names) {
+					problem = err_corrupt;
+				} else {
+					_names.push_back(interned[bind[i]]);
+				}
+			}
+			prev = 0;
+			for (std::size_t i = 0; !problem && i < _count; ++i) {
+				if (_ends[i] < prev || _ends[i] > _nodeCount) {
+					problem = err_corrupt;
+				}
+				prev = _ends[i];
+			}
+		}
+	}
+	if (problem != nullptr) {
+		close();
+		error = problem;
+		return false;
+	}
+	return true;
+}
+
+const FlatNode* FlatFile::begin(std::size_t i) const {
+	return _nodes + (i == 0 ? 0 : _ends[i - 1]);
+}
+
+const FlatNode* FlatFile::end(std::size_t i) const {
+	return _nodes + _ends[i];
+}
+
+Sentence* FlatFile::decode(std::size_t i) const {
+	return decodeFlat(begin(i), end(i), _names);
+}
@@ -0,0 +1,152 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Sentence;
+
+// The version of the binary format written by Encoder. Files with any other
+// version are rejected when they are opened.
+const std::uint32_t flat_version = 4;
+
+// The tag of a flat node says what kind of object or sentence it encodes. The
+// values are part of the file format, so they must never change.
+enum FlatTag : std::uint8_t {
+	FLAT_NUMBER = 0, // payload is a 32-bit integer (as two's complement)
+	FLAT_COMPOUND_NUMBER = 1, // two operands
+	FLAT_CONCRETE_SET = 2, // payload is the number of elements
+	FLAT_SPECIAL_SET = 3, // no operands
+	FLAT_COMPOUND_SET = 4, // two operands
+	FLAT_SYMBOL = 5, // payload is the binding index, flag is true if bound by
+	                 // an enclosing quantifier
+	FLAT_LOGICAL = 6, // two operands
+	FLAT_RELATION = 7, // two operands, flag is true if positive
+	FLAT_QUANTIFIED = 8, // the variable and the body
+	FLAT_LIMB = 9, // payload is 32 bits of a big number's magnitude
+	FLAT_BIG_NUMBER = 10, // payload is the number of limbs before it, flag is
+	                      // true if negative
+	FLAT_RANGE_SET = 11 // payload is the number of intervals, each given by
+	                    // two numbers
+};
+
+// A flat node is one node of a sentence in a flat postfix encoding, where each
+// node comes right after all its operands. The type is the type enumerator of
+// the node's class (for example, Logical::AND). The meaning of the flag and
+// the payload depends on the tag.
+class FlatNode {
+public:
+	std::uint8_t _tag; // a FlatTag
+	std::uint8_t _type; // the type enumerator
+	std::uint8_t _flag; // 0 or 1
+	std::uint8_t _unused; // always 0
+	std::uint32_t _payload; // a small integer
+};
+
+// A flat code is a list of sentences in flat postfix encoding. Symbols are
+// encoded as binding indices: each distinct symbol identifier gets the next
+// index the first time it is seen, and all occurrences of it refer to that
+// index. The interned name and identifier of each binding are stored
+// separately. Identifiers only make sense within one process, so they are not
+// written to binary files.
+class FlatCode {
+public:
+	// Returns the number of sentences.
+	std::size_t size() const { return _ends.size(); }
+
+	// Returns the range of nodes making up sentence i. The root is the last.
+	const FlatNode* begin(std::size_t i) const;
+	const FlatNode* end(std::size_t i) const;
+
+	// Reconstructs sentence i. Its symbols have the same identifiers as the
+	// ones that were encoded. Returns null if its nodes are malformed.
+	Sentence* decode(std::size_t i) const;
+
+	std::vector<FlatNode> _nodes; // the nodes of all the sentences
+	std::vector<std::uint32_t> _ends; // the end of each sentence in _nodes
+	std::vector<unsigned int> _names; // the interned name of each binding
+	std::vector<unsigned int> _ids; // the identifier of each binding
+};
+
+// An encoder converts sentences to flat postfix encoding. Sentences do this by
+// visiting their operands and then calling node.
+class Encoder {
+public:
+	// Appends the encoding of the sentence to the code.
+	void add(const Sentence& s);
+
+	// Appends a node to the sentence being encoded.
+	void node(FlatTag tag, int type, bool flag, std::uint32_t payload);
+
+	// Returns the binding index for the symbol, assigning a new one if this
+	// is the first time the identifier has been seen.
+	std::uint32_t binding(unsigned int name, unsigned int id);
+
+	// Returns the code produced so far.
+	const FlatCode& code() const { return _code; }
+
+	// Writes the code to a file in binary form. Returns false on failure,
+	// storing the reason in error.
+	bool write(const char* path, std::string& error) const;
+
+private:
+	FlatCode _code; // the encoded sentences
+	std::unordered_map<unsigned int, std::uint32_t> _bindings; // id to index
+};
+
+// A flat file gives access to a binary file written by Encoder. The file is
+// memory-mapped, and its nodes are used in place without copying them, so
+// opening a file is fast no matter how many sentences it holds. Sentences can
+// be traversed directly or reconstructed one at a time.
+class FlatFile {
+public:
+	FlatFile();
+	~FlatFile();
+
+	// Maps the file and checks its header. Returns false on failure, storing
+	// the reason in error.
+	bool open(const char* path, std::string& error);
+
+	// Unmaps the file, if one is open.
+	void close();
+
+	// Returns the number of sentences.
+	std::size_t size() const { return _count; }
+
+	// Returns the range of nodes making up sentence i. The root is the last.
+	const FlatNode* begin(std::size_t i) const;
+	const FlatNode* end(std::size_t i) const;
+
+	// Reconstructs sentence i. Returns null if its nodes are malformed.
+	Sentence* decode(std::size_t i) const;
+
+private:
+	FlatFile(const FlatFile&) = delete;
+	FlatFile& operator=(const FlatFile&) = delete;
+
+	void* _map; // the mapped file, or null
+	std::size_t _mapSize; // the size of the mapping
+	std::size_t _count; // the number of sentences
+	const std::uint32_t* _ends; // the end of each sentence
+	const FlatNode* _nodes; // the nodes of all the sentences
+	std::uint32_t _nodeCount; // the total number of nodes
+	std::vector<unsigned int> _names; // the interned name of each binding
+};
+
+// Returns true if the data starts with the magic bytes of a binary file.
+bool hasFlatMagic(const char* data, std::size_t size);
+
+// Reconstructs a sentence from the nodes in [begin, end), using names to look
+// up the interned name of each binding. If ids is given, each binding reuses
+// its identifier; otherwise, each gets a new unique identifier. Returns null
+// if the nodes are not a valid encoding of exactly one sentence.
+Sentence* decodeFlat(const FlatNode* begin, const FlatNode* end,
+	const std::vector<unsigned int>& names,
+	const std::vector<unsigned int>* ids = nullptr);
+
+#endif
@@ -0,0 +1,247 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "eval.hpp"
+
+#include "object.hpp"
+
+namespace {
+	// The most elements a set can have for subset tests to enumerate it.
+	const std::size_t subset_limit = 1 << 16;
+
+	// The sort of an object once its symbol (if any) is resolved. A symbol
+	// that is not bound could stand for anything, so its sort is unknown.
+	enum Sort { NUMBER, SET, UNKNOWN };
+}
+
+// Returns the value bound to the object if it is a symbol, or else the object.
+static const Object& resolve(const Object& obj, const Env& env) {
+	if (auto sym = objectCast<Symbol>(&obj)) {
+		if (const Object* value = sym->lookup(env)) {
+			return *value;
+		}
+	}
+	return obj;
+}
+
+// Returns the sort of a resolved object.
+static Sort sortOf(const Object& obj) {
+	if (obj.kind() == Object::SYMBOL) {
+		return UNKNOWN;
+	}
+	return obj.isNumber() ? NUMBER : SET;
+}
+
+// Evaluates a resolved object if it is a ground number.
+static bool evalNumber(const Object& obj, const Env& env, Integer& out) {
+	return obj.isNumber() && obj.evaluate(out, env);
+}
+
+Sentence::Value evalEqual(const Object& a, const Object& b, const Env& env) {
+	const Object& x = resolve(a, env);
+	const Object& y = resolve(b, env);
+	if (x.equal(y)) {
+		return Sentence::TRUE;
+	}
+	Sort sx = sortOf(x);
+	Sort sy = sortOf(y);
+	if (sx == UNKNOWN || sy == UNKNOWN) {
+		return Sentence::MU;
+	}
+	if (sx != sy) {
+		return Sentence::FALSE;
+	}
+	if (sx == NUMBER) {
+		Integer i, j;
+		if (!evalNumber(x, env, i) || !evalNumber(y, env, j)) {
+			return Sentence::MU;
+		}
+		return static_cast<Sentence::Value>(i == j);
+	}
+	return valueAnd(evalSubset(x, y, env), evalSubset(y, x, env));
+}
+
+Sentence::Value evalIn(const Object& x0, const Object& s0, const Env& env) {
+	const Object& x = resolve(x0, env);
+	const Object& s = resolve(s0, env);
+	Sort sx = sortOf(x);
+	Integer n;
+	bool known = sx == NUMBER && evalNumber(x, env, n);
+
+	if (auto c = objectCast<ConcreteSet>(&s)) {
+		if (c->contains(x) || (known && c->contains(ConcreteNumber(n)))) {
+			return Sentence::TRUE;
+		}
+		// An unknown number might be one of the integers.
+		Sentence::Value result = Sentence::FALSE;
+		if (sx != SET && !known && c->size() > c->others().size()) {
+			result = Sentence::MU;
+		}
+		for (const Object* e: c->others()) {
+			Sentence::Value v = evalEqual(x, *e, env);
+			if (v == Sentence::TRUE) {
+				return v;
+			}
+			if (v == Sentence::MU) {
+				result = v;
+			}
+		}
+		return result;
+	}
+	if (auto r = objectCast<RangeSet>(&s)) {
+		if (sx == SET) {
+			return Sentence::FALSE;
+		}
+		if (!known) {
+			return Sentence::MU;
+		}
+		if (n.isSmall()) {
+			return static_cast<Sentence::Value>(r->contains(n.small()));
+		}
+		// Integers too large for the intervals are only in unbounded ones.
+		const NodeVec<RangeSet::Interval>& v = r->intervals();
+		return static_cast<Sentence::Value>(!v.empty() && (n.negative()
+			? v.front().first == RangeSet::MIN
+			: v.back().second == RangeSet::MAX));
+	}
+	if (auto special = objectCast<SpecialSet>(&s)) {
+		if (sx == UNKNOWN && special->type() != SpecialSet::EMPTY) {
+			return Sentence::MU;
+		}
+		switch (special->type()) {
+		case SpecialSet::EMPTY:
+			return Sentence::FALSE;
+		case SpecialSet::INTEGERS:
+			return static_cast<Sentence::Value>(sx == NUMBER);
+		case SpecialSet::NATURALS:
+			// Whether zero is a natural number is left open.
+			if (sx == SET) {
+				return Sentence::FALSE;
+			}
+			if (!known || n == 0) {
+				return Sentence::MU;
+			}
+			return static_cast<Sentence::Value>(!n.negative());
+		case SpecialSet::SETS:
+			return static_cast<Sentence::Value>(sx == SET);
+		}
+	}
+	if (auto compound = objectCast<CompoundSet>(&s)) {
+		Sentence::Value a = evalIn(x, compound->first(), env);
+		Sentence::Value b = evalIn(x, compound->second(), env);
+		switch (compound->type()) {
+		case CompoundSet::UNION: return valueOr(a, b);
+		case CompoundSet::INTERSECT: return valueAnd(a, b);
+		case CompoundSet::DIFF: return valueAnd(a, valueNot(b));
+		}
+	}
+	return sortOf(s) == UNKNOWN ? Sentence::MU : Sentence::FALSE;
+}
+
+Sentence::Value evalSubset(const Object& a0, const Object& b0,
+		const Env& env) {
+	const Object& a = resolve(a0, env);
+	const Object& b = resolve(b0, env);
+	if (a.equal(b)) {
+		return Sentence::TRUE;
+	}
+	Sort sa = sortOf(a);
+	Sort sb = sortOf(b);
+	if (sa == UNKNOWN || sb == UNKNOWN) {
+		return Sentence::MU;
+	}
+	if (sa == NUMBER || sb == NUMBER) {
+		return Sentence::FALSE;
+	}
+
+	// Sets of integers can be compared exactly as range sets.
+	RangeSet* ra = RangeSet::fromSet(a);
+	RangeSet* rb = RangeSet::fromSet(b);
+	Sentence::Value result = Sentence::MU;
+	if (ra != nullptr && rb != nullptr) {
+		result = static_cast<Sentence::Value>(ra->subsetOf(*rb));
+	} else if (ra != nullptr && !ra->bounded()
+			&& objectCast<ConcreteSet>(&b) != nullptr) {
+		// An infinite set can't be a subset of a finite one.
+		result = Sentence::FALSE;
+	}
+	bool decided = ra != nullptr && (rb != nullptr || result != Sentence::MU);
+	delete ra;
+	delete rb;
+	if (decided) {
+		return result;
+	}
+
+	auto ca = objectCast<CompoundSet>(&a);
+	if (ca != nullptr && ca->type() == CompoundSet::UNION) {
+		return valueAnd(evalSubset(ca->first(), b, env),
+			evalSubset(ca->second(), b, env));
+	}
+	auto cb = objectCast<CompoundSet>(&b);
+	if (cb != nullptr && cb->type() == CompoundSet::INTERSECT) {
+		return valueAnd(evalSubset(a, cb->first(), env),
+			evalSubset(a, cb->second(), env));
+	}
+
+	result = Sentence::TRUE;
+	bool finite = forEachElement(a, env, subset_limit, [&](const Object& x) {
+		Sentence::Value v = evalIn(x, b, env);
+		if (v == Sentence::FALSE) {
+			result = v;
+			return false;
+		}
+		if (v == Sentence::MU) {
+			result = v;
+		}
+		return true;
+	});
+	return finite ? result : Sentence::MU;
+}
+
+bool forEachElement(const Object& set0, const Env& env, std::size_t limit,
+		const std::function<bool(const Object&)>& f) {
+	const Object& set = resolve(set0, env);
+	if (auto c = objectCast<ConcreteSet>(&set)) {
+		if (c->size() > limit) {
+			return false;
+		}
+		for (long long x: c->integers()) {
+			if (!f(ConcreteNumber(x))) {
+				return true;
+			}
+		}
+		for (const Object* e: c->others()) {
+			if (!f(resolve(*e, env))) {
+				return true;
+			}
+		}
+		return true;
+	}
+	if (auto r = objectCast<RangeSet>(&set)) {
+		if (!r->bounded()) {
+			return false;
+		}
+		// Count in unsigned arithmetic, since an interval can be wider than
+		// the largest long long.
+		unsigned long long total = 0;
+		for (const RangeSet::Interval& i: r->intervals()) {
+			unsigned long long width = static_cast<unsigned long long>(i.second)
+				- static_cast<unsigned long long>(i.first);
+			if (width >= limit || (total += width + 1) > limit) {
+				return false;
+			}
+		}
+		for (const RangeSet::Interval& i: r->intervals()) {
+			for (long long x = i.first;; ++x) {
+				if (!f(ConcreteNumber(x))) {
+					return true;
+				}
+				if (x == i.second) {
+					break;
+				}
+			}
+		}
+		return true;
+	}
+	auto special = objectCast<SpecialSet>(&set);
+	return special != nullptr && special->type() == SpecialSet::EMPTY;
+}
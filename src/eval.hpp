@@ -0,0 +1,35 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "sentence.hpp"
+
+#include <cstddef>
+#include <functional>
+
+class Env;
+class Object;
+
+// These functions decide relationships between objects for the evaluation of
+// relations. Symbols bound in the environment stand for their values. The
+// result is MU when the objects are not ground enough to decide, such as when
+// an unbound symbol might or might not be equal to something.
+
+// Returns whether the objects are equal. Sets are equal if they have the same
+// elements, even if they are written differently.
+Sentence::Value evalEqual(const Object& a, const Object& b, const Env& env);
+
+// Returns whether x is an element of the set s.
+Sentence::Value evalIn(const Object& x, const Object& s, const Env& env);
+
+// Returns whether every element of a is also an element of b.
+Sentence::Value evalSubset(const Object& a, const Object& b, const Env& env);
+
+// If the set is finite and has at most limit elements, calls f on each element
+// until it returns false, and then returns true. Otherwise, returns false
+// without calling f.
+bool forEachElement(const Object& set, const Env& env, std::size_t limit,
+	const std::function<bool(const Object&)>& f);
+
+#endif
@@ -0,0 +1,392 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "flat.hpp"
+
+#include "hash.hpp"
+#include "integer.hpp"
+#include "object.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <utility>
+
+namespace {
+	// An operator whose operands are still being printed by printFlat.
+	struct Pending {
+		const FlatNode* _node; // the operator node
+		std::uint32_t _left; // the number of operands left to print
+	};
+
+	// The hash of a subtree on the stack of hashFlat. Integers are hashed
+	// differently as elements of concrete and range sets, so numbers also keep
+	// their value.
+	struct HashEntry {
+		std::uint64_t _hash; // the structural hash
+		std::uint64_t _intHash; // the hash of the integer, for numbers
+		long long _value; // the value of the integer, if it fits
+		bool _isInt; // true if this is a number that fits in 64 bits
+	};
+}
+
+// Reads the number whose last node is n: either a FLAT_NUMBER, or a
+// FLAT_BIG_NUMBER following its limbs. Returns the first node of the number.
+static const FlatNode* readNumber(const FlatNode* n, Integer& out) {
+	if (n->_tag == FLAT_NUMBER) {
+		out = Integer(static_cast<std::int32_t>(n->_payload));
+		return n;
+	}
+	const FlatNode* first = n - n->_payload;
+	std::vector<std::uint32_t> limbs;
+	limbs.reserve(n->_payload);
+	for (const FlatNode* p = first; p != n; ++p) {
+		limbs.push_back(p->_payload);
+	}
+	out = Integer::fromMagnitude(limbs.data(), limbs.size(), n->_flag);
+	return first;
+}
+
+// =============================================================================
+//            Printing
+// =============================================================================
+
+// printFlat builds its output backwards, walking from the root at the end of
+// the nodes to the start. Each piece of text is appended in reverse, and the
+// whole string is reversed at the end. This way operators are met before their
+// operands, and no pass is needed to find where each subtree begins.
+
+// Appends the string to out in reverse.
+static void putBack(std::string& out, const char* str) {
+	std::size_t n = std::strlen(str);
+	while (n > 0) {
+		out += str[--n];
+	}
+}
+static void putBack(std::string& out, const std::string& str) {
+	out.append(str.rbegin(), str.rend());
+}
+
+// Appends a small integer to out in reverse. The digits come out least
+// significant first, which is already reversed.
+static void putBack(std::string& out, long long x) {
+	unsigned long long m = x < 0
+		? 0ull - static_cast<unsigned long long>(x)
+		: static_cast<unsigned long long>(x);
+	do {
+		out += static_cast<char>('0' + m % 10);
+		m /= 10;
+	} while (m != 0);
+	if (x < 0) {
+		out += '-';
+	}
+}
+
+// Appends the text that comes before the operands of the operator, or between
+// them, in reverse.
+static void putOpening(std::string& out, const FlatNode* n) {
+	const char* name = "";
+	switch (n->_tag) {
+	case FLAT_CONCRETE_SET:
+		out += '{';
+		return;
+	case FLAT_COMPOUND_NUMBER:
+		name = CompoundNumber::name(static_cast<CompoundNumber::Type>(n->_type));
+		break;
+	case FLAT_COMPOUND_SET:
+		name = CompoundSet::name(static_cast<CompoundSet::Type>(n->_type));
+		break;
+	case FLAT_LOGICAL:
+		name = Logical::name(static_cast<Logical::Type>(n->_type));
+		break;
+	case FLAT_RELATION:
+		name = Relation::name(static_cast<Relation::Type>(n->_type),
+			n->_flag != 0);
+		break;
+	case FLAT_QUANTIFIED:
+		name = Quantified::name(static_cast<Quantified::Type>(n->_type));
+		break;
+	}
+	out += ' ';
+	putBack(out, name);
+	out += '(';
+}
+static void putSeparator(std::string& out, const FlatNode* n) {
+	putBack(out, n->_tag == FLAT_CONCRETE_SET ? ", " : " ");
+}
+
+// Appends a range set whose node is n in reverse, and returns its first node.
+// Like RangeSet::print, every interval gets an ellipsis.
+static const FlatNode* putRangeSet(std::string& out, const FlatNode* n) {
+	std::vector<long long> bounds(2 * static_cast<std::size_t>(n->_payload));
+	const FlatNode* p = n;
+	for (std::size_t k = bounds.size(); k-- > 0;) {
+		Integer x;
+		p = readNumber(p - 1, x);
+		bounds[k] = x.small();
+	}
+	out += '}';
+	for (std::size_t k = bounds.size(); k > 0; k -= 2) {
+		if (k != bounds.size()) {
+			putBack(out, ", ");
+		}
+		if (bounds[k - 1] != RangeSet::MAX) {
+			putBack(out, bounds[k - 1]);
+			putBack(out, ", ");
+		}
+		putBack(out, "...");
+		if (bounds[k - 2] != RangeSet::MIN) {
+			putBack(out, ", ");
+			putBack(out, bounds[k - 2]);
+		}
+	}
+	out += '{';
+	return p;
+}
+
+std::ostream& printFlat(std::ostream& s, const FlatNode* begin,
+		const FlatNode* end, const std::vector<unsigned int>& names) {
+	std::string out;
+	out.reserve(static_cast<std::size_t>(end - begin) * 4);
+	std::vector<Pending> stack;
+	const FlatNode* n = end;
+	while (n != begin) {
+		--n;
+		switch (n->_tag) {
+		case FLAT_NUMBER:
+			putBack(out, static_cast<long long>(
+				static_cast<std::int32_t>(n->_payload)));
+			break;
+		case FLAT_BIG_NUMBER: {
+			Integer x;
+			n = readNumber(n, x);
+			putBack(out, x.str());
+			break;
+		}
+		case FLAT_SPECIAL_SET:
+			putBack(out, SpecialSet::name(
+				static_cast<SpecialSet::Type>(n->_type)));
+			break;
+		case FLAT_SYMBOL:
+			putBack(out, nameString(names[n->_payload]));
+			break;
+		case FLAT_RANGE_SET:
+			n = putRangeSet(out, n);
+			break;
+		default: {
+			// An operator: its operands come next, unless it has none.
+			bool set = n->_tag == FLAT_CONCRETE_SET;
+			out += set ? '}' : ')';
+			std::uint32_t arity = set ? n->_payload : 2;
+			stack.push_back(Pending{n, arity});
+			if (arity > 0) {
+				continue;
+			}
+			break;
+		}
+		}
+		// A subtree is finished, which may finish the operators above it.
+		while (!stack.empty()) {
+			Pending& p = stack.back();
+			if (p._left > 0 && --p._left > 0) {
+				putSeparator(out, p._node);
+				break;
+			}
+			putOpening(out, p._node);
+			stack.pop_back();
+		}
+	}
+	std::reverse(out.begin(), out.end());
+	return s << out;
+}
+
+// =============================================================================
+//            Hashing and equality
+// =============================================================================
+
+// The hashes computed here combine the same values in the same order as the
+// computeHash methods of the objects and sentences.
+std::uint64_t hashFlat(const FlatNode* begin, const FlatNode* end,
+		const std::vector<unsigned int>* ids) {
+	std::vector<HashEntry> stack;
+	for (const FlatNode* n = begin; n != end; ++n) {
+		HashEntry e = {0, 0, 0, false};
+		std::size_t first;
+		switch (n->_tag) {
+		case FLAT_LIMB:
+			continue;
+		case FLAT_NUMBER:
+		case FLAT_BIG_NUMBER: {
+			Integer x;
+			readNumber(n, x);
+			e._intHash = x.hash();
+			e._hash = hashMix(FLAT_NUMBER, e._intHash);
+			e._value = x.small();
+			e._isInt = x.isSmall();
+			break;
+		}
+		case FLAT_SPECIAL_SET:
+			e._hash = hashMix(FLAT_SPECIAL_SET, n->_type);
+			break;
+		case FLAT_SYMBOL:
+			if (n->_flag) {
+				e._hash = hashMix(FLAT_SYMBOL, SymMap::NONE);
+			} else {
+				e._hash = hashMix(FLAT_SYMBOL,
+					ids == nullptr ? n->_payload : (*ids)[n->_payload]);
+			}
+			break;
+		case FLAT_CONCRETE_SET: {
+			// The integers come first, in order, and the other elements are
+			// combined in a way that does not depend on order.
+			first = stack.size() - n->_payload;
+			std::uint64_t h = hashMix(FLAT_CONCRETE_SET, n->_payload);
+			std::uint64_t sum = 0;
+			for (std::size_t k = first; k < stack.size(); ++k) {
+				if (stack[k]._isInt) {
+					h = hashMix(h, stack[k]._intHash);
+				} else {
+					sum += hashMix(0, stack[k]._hash);
+				}
+			}
+			e._hash = hashMix(h, sum);
+			stack.resize(first);
+			break;
+		}
+		case FLAT_RANGE_SET: {
+			first = stack.size() - 2 * static_cast<std::size_t>(n->_payload);
+			std::uint64_t h = hashMix(FLAT_RANGE_SET, n->_payload);
+			for (std::size_t k = first; k < stack.size(); ++k) {
+				h = hashMix(h, static_cast<std::uint64_t>(stack[k]._value));
+			}
+			e._hash = h;
+			stack.resize(first);
+			break;
+		}
+		case FLAT_QUANTIFIED:
+			// The variable is only a name, and is left out.
+			first = stack.size() - 2;
+			e._hash = hashMix(hashMix(FLAT_QUANTIFIED, n->_type),
+				stack[first + 1]._hash);
+			stack.resize(first);
+			break;
+		default: {
+			std::uint64_t h = n->_tag == FLAT_RELATION
+				? hashMix(FLAT_RELATION,
+					static_cast<unsigned int>(n->_type) << 1
+					| static_cast<unsigned int>(n->_flag))
+				: hashMix(n->_tag, n->_type);
+			first = stack.size() - 2;
+			e._hash = hashMix(hashMix(h, stack[first]._hash),
+				stack[first + 1]._hash);
+			stack.resize(first);
+			break;
+		}
+		}
+		e._hash |= 1;
+		stack.push_back(e);
+	}
+	return stack.back()._hash;
+}
+
+bool equalFlat(const FlatNode* aBegin, const FlatNode* aEnd,
+		const FlatNode* bBegin, const FlatNode* bEnd,
+		const std::vector<unsigned int>& names) {
+	std::size_t size = static_cast<std::size_t>(aEnd - aBegin);
+	if (size == static_cast<std::size_t>(bEnd - bBegin)
+			&& std::memcmp(aBegin, bBegin, size * sizeof(FlatNode)) == 0) {
+		return true;
+	}
+	if (hashFlat(aBegin, aEnd) != hashFlat(bBegin, bEnd)) {
+		return false;
+	}
+	// Use the binding indices as identifiers, so that a binding decodes to
+	// the same symbol in both sentences.
+	std::vector<unsigned int> ids(names.size());
+	std::iota(ids.begin(), ids.end(), 0u);
+	Sentence* a = decodeFlat(aBegin, aEnd, names, &ids);
+	Sentence* b = decodeFlat(bBegin, bEnd, names, &ids);
+	bool equal = a != nullptr && b != nullptr && a->equal(*b);
+	delete a;
+	delete b;
+	return equal;
+}
+
+// =============================================================================
+//            Evaluation
+// =============================================================================
+
+bool evaluateFlat(const FlatNode* begin, const FlatNode* end,
+		Sentence::Value& out) {
+	// Numbers and truth values go on separate stacks, since the operands of
+	// each node have a fixed sort.
+	std::vector<Integer> numbers;
+	std::vector<Sentence::Value> values;
+	for (const FlatNode* n = begin; n != end; ++n) {
+		switch (n->_tag) {
+		case FLAT_LIMB:
+			break;
+		case FLAT_NUMBER:
+		case FLAT_BIG_NUMBER: {
+			Integer x;
+			readNumber(n, x);
+			numbers.push_back(std::move(x));
+			break;
+		}
+		case FLAT_COMPOUND_NUMBER: {
+			Integer b = std::move(numbers.back());
+			numbers.pop_back();
+			Integer& a = numbers.back();
+			switch (n->_type) {
+			case CompoundNumber::ADD: a = a + b; break;
+			case CompoundNumber::SUB: a = a - b; break;
+			case CompoundNumber::MUL: a = a * b; break;
+			}
+			break;
+		}
+		case FLAT_RELATION: {
+			const Integer& x = numbers[numbers.size() - 2];
+			const Integer& y = numbers.back();
+			int c = Integer::compare(x, y);
+			Sentence::Value v = Sentence::MU;
+			switch (n->_type) {
+			case Relation::EQ: v = static_cast<Sentence::Value>(c == 0); break;
+			case Relation::LT: v = static_cast<Sentence::Value>(c < 0); break;
+			case Relation::LTE: v = static_cast<Sentence::Value>(c <= 0); break;
+			case Relation::DIV:
+				if (x.isSmall() && y.isSmall()) {
+					long long d = x.small();
+					long long m = y.small();
+					v = static_cast<Sentence::Value>(
+						d == 0 ? m == 0 : d == -1 || m % d == 0);
+				}
+				break;
+			default:
+				return false;
+			}
+			numbers.resize(numbers.size() - 2);
+			values.push_back(n->_flag ? v : valueNot(v));
+			break;
+		}
+		case FLAT_LOGICAL: {
+			Sentence::Value b = values.back();
+			values.pop_back();
+			Sentence::Value& a = values.back();
+			switch (n->_type) {
+			case Logical::AND: a = valueAnd(a, b); break;
+			case Logical::OR: a = valueOr(a, b); break;
+			case Logical::IMPLIES: a = valueOr(valueNot(a), b); break;
+			case Logical::IFF:
+				a = a == Sentence::MU || b == Sentence::MU
+					? Sentence::MU : static_cast<Sentence::Value>(a == b);
+				break;
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	out = values.back();
+	return true;
+}
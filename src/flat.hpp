@@ -0,0 +1,47 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef FLAT_H
+#define FLAT_H
+
+#include "encode.hpp"
+#include "sentence.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// These kernels work on a sentence in flat postfix encoding (see FlatCode and
+// FlatFile) without reconstructing it. They stream through the nodes in order,
+// keeping a small stack of operands, instead of chasing pointers and making a
+// virtual call per node. The nodes in [begin, end) must be a valid encoding of
+// one sentence, such as one written by Encoder.
+
+// Prints the sentence exactly as Sentence::print would print its decoding,
+// using names to look up the interned name of each binding.
+std::ostream& printFlat(std::ostream& s, const FlatNode* begin,
+	const FlatNode* end, const std::vector<unsigned int>& names);
+
+// Returns the structural hash of the sentence. If ids gives the identifier of
+// each binding, this is the same as the hash of the sentence that was encoded.
+// Otherwise, bindings are hashed by index, which is consistent for sentences in
+// the same code or file.
+std::uint64_t hashFlat(const FlatNode* begin, const FlatNode* end,
+	const std::vector<unsigned int>* ids = nullptr);
+
+// Returns true if two sentences from the same code or file are structurally
+// equal. Equal sentences almost always have identical encodings, so this is
+// usually one comparison of the node arrays. Only when the encodings differ but
+// the hashes agree (as when the elements of a set are listed in a different
+// order) are the sentences decoded and compared.
+bool equalFlat(const FlatNode* aBegin, const FlatNode* aEnd,
+	const FlatNode* bBegin, const FlatNode* bEnd,
+	const std::vector<unsigned int>& names);
+
+// Evaluates a sentence made only of logical connectives and relations between
+// ground numbers (=, <, <=, and div, or their negations), storing the same
+// value Sentence::value would give in out. Returns false without evaluating if
+// the sentence has symbols, sets, or quantifiers.
+bool evaluateFlat(const FlatNode* begin, const FlatNode* end,
+	Sentence::Value& out);
+
+#endif
@@ -0,0 +1,17 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+
+// Combines a value into a running 64-bit hash. The value is scrambled first,
+// so that small integers that differ in one bit spread over the whole hash.
+inline std::uint64_t hashMix(std::uint64_t h, std::uint64_t v) {
+	v *= 0x9e3779b97f4a7c15ull;
+	v ^= v >> 32;
+	h = (h ^ v) * 0xff51afd7ed558ccdull;
+	return h ^ (h >> 29);
+}
+
+#endif
@@ -0,0 +1,312 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "integer.hpp"
+
+#include "arena.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+// A magnitude is an unsigned integer stored as 32-bit limbs, least significant
+// first, with no leading zero limbs.
+typedef std::vector<std::uint32_t> Mag;
+
+// =============================================================================
+//            Magnitudes
+// =============================================================================
+
+// Removes leading zero limbs.
+static void trim(Mag& m) {
+	while (!m.empty() && m.back() == 0) {
+		m.pop_back();
+	}
+}
+
+// Returns the magnitude of a 64-bit value.
+static Mag magOf(unsigned long long u) {
+	Mag m;
+	while (u != 0) {
+		m.push_back(static_cast<std::uint32_t>(u));
+		u >>= 32;
+	}
+	return m;
+}
+
+// Compares two magnitudes, returning -1, 0, or 1.
+static int compareMag(const Mag& a, const Mag& b) {
+	if (a.size() != b.size()) {
+		return a.size() < b.size() ? -1 : 1;
+	}
+	for (std::size_t i = a.size(); i-- > 0;) {
+		if (a[i] != b[i]) {
+			return a[i] < b[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+// Returns a + b.
+static Mag addMag(const Mag& a, const Mag& b) {
+	const Mag& big = a.size() >= b.size() ? a : b;
+	const Mag& little = a.size() >= b.size() ? b : a;
+	Mag r(big.size() + 1);
+	std::uint64_t carry = 0;
+	for (std::size_t i = 0; i < big.size(); ++i) {
+		carry += big[i];
+		if (i < little.size()) {
+			carry += little[i];
+		}
+		r[i] = static_cast<std::uint32_t>(carry);
+		carry >>= 32;
+	}
+	r[big.size()] = static_cast<std::uint32_t>(carry);
+	trim(r);
+	return r;
+}
+
+// Returns a - b, assuming a >= b.
+static Mag subMag(const Mag& a, const Mag& b) {
+	Mag r(a.size());
+	std::int64_t borrow = 0;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		std::int64_t d = static_cast<std::int64_t>(a[i]) - borrow
+			- (i < b.size() ? static_cast<std::int64_t>(b[i]) : 0);
+		borrow = d < 0;
+		r[i] = static_cast<std::uint32_t>(d + (borrow << 32));
+	}
+	trim(r);
+	return r;
+}
+
+// Returns a * b.
+static Mag mulMag(const Mag& a, const Mag& b) {
+	if (a.empty() || b.empty()) {
+		return Mag();
+	}
+	Mag r(a.size() + b.size());
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		std::uint64_t carry = 0;
+		for (std::size_t j = 0; j < b.size(); ++j) {
+			carry += static_cast<std::uint64_t>(a[i]) * b[j] + r[i + j];
+			r[i + j] = static_cast<std::uint32_t>(carry);
+			carry >>= 32;
+		}
+		r[i + b.size()] = static_cast<std::uint32_t>(carry);
+	}
+	trim(r);
+	return r;
+}
+
+// Sets m to m * mul + add.
+static void mulAddSmall(Mag& m, std::uint32_t mul, std::uint32_t add) {
+	std::uint64_t carry = add;
+	for (std::uint32_t& limb: m) {
+		carry += static_cast<std::uint64_t>(limb) * mul;
+		limb = static_cast<std::uint32_t>(carry);
+		carry >>= 32;
+	}
+	if (carry != 0) {
+		m.push_back(static_cast<std::uint32_t>(carry));
+	}
+}
+
+// Divides m by div in place, returning the remainder.
+static std::uint32_t divSmall(Mag& m, std::uint32_t div) {
+	std::uint64_t rem = 0;
+	for (std::size_t i = m.size(); i-- > 0;) {
+		std::uint64_t cur = rem << 32 | m[i];
+		m[i] = static_cast<std::uint32_t>(cur / div);
+		rem = cur % div;
+	}
+	trim(m);
+	return static_cast<std::uint32_t>(rem);
+}
+
+// Returns a mod b, assuming b is not zero. Divisors of one limb use divSmall;
+// otherwise, this does binary long division, one bit of a at a time.
+static Mag remMag(const Mag& a, const Mag& b) {
+	if (b.size() == 1) {
+		Mag q = a;
+		return magOf(divSmall(q, b[0]));
+	}
+	Mag r;
+	for (std::size_t i = a.size(); i-- > 0;) {
+		for (int bit = 31; bit >= 0; --bit) {
+			mulAddSmall(r, 2, a[i] >> bit & 1);
+			if (compareMag(r, b) >= 0) {
+				r = subMag(r, b);
+			}
+		}
+	}
+	return r;
+}
+
+// Returns the integer with the given magnitude and sign, using the inline form
+// if it fits in 64 bits.
+static Integer make(const Mag& m, bool negative) {
+	return Integer::fromMagnitude(m.data(), m.size(), negative);
+}
+
+// =============================================================================
+//            Integer
+// =============================================================================
+
+Integer::Integer(const Integer& other) : _value(other._value), _limbs(nullptr) {
+	if (other._limbs != nullptr) {
+		std::size_t bytes = (other._limbs[0] + 1) * sizeof(std::uint32_t);
+		_limbs = static_cast<std::uint32_t*>(allocNode(bytes));
+		std::memcpy(_limbs, other._limbs, bytes);
+	}
+}
+
+Integer& Integer::operator=(Integer other) {
+	std::swap(_value, other._value);
+	std::swap(_limbs, other._limbs);
+	return *this;
+}
+
+Integer::~Integer() {
+	freeNode(_limbs);
+}
+
+Integer Integer::fromMagnitude(const std::uint32_t* limbs, std::size_t n,
+		bool negative) {
+	while (n > 0 && limbs[n - 1] == 0) {
+		--n;
+	}
+	if (n <= 2) {
+		unsigned long long u = n == 0 ? 0 : limbs[0];
+		if (n == 2) {
+			u |= static_cast<unsigned long long>(limbs[1]) << 32;
+		}
+		const unsigned long long max =
+			static_cast<unsigned long long>(std::numeric_limits<long long>::max());
+		if (u <= max) {
+			long long v = static_cast<long long>(u);
+			return Integer(negative ? -v : v);
+		}
+		if (negative && u == max + 1) {
+			return Integer(std::numeric_limits<long long>::min());
+		}
+	}
+	Integer x;
+	x._value = negative ? -1 : 1;
+	x._limbs = static_cast<std::uint32_t*>(
+		allocNode((n + 1) * sizeof(std::uint32_t)));
+	x._limbs[0] = static_cast<std::uint32_t>(n);
+	std::memcpy(x._limbs + 1, limbs, n * sizeof(std::uint32_t));
+	return x;
+}
+
+bool Integer::parse(const char* begin, const char* end, Integer& out) {
+	const char* p = begin;
+	bool neg = false;
+	if (p != end && (*p == '-' || *p == '+')) {
+		neg = (*p == '-');
+		++p;
+	}
+	if (p == end) {
+		return false;
+	}
+	// Consume up to nine digits at a time, which always fit in 32 bits.
+	Mag m;
+	while (p != end) {
+		std::uint32_t chunk = 0;
+		std::uint32_t scale = 1;
+		for (int k = 0; k < 9 && p != end; ++k, ++p) {
+			std::uint32_t digit = static_cast<std::uint32_t>(*p - '0');
+			if (digit > 9) {
+				return false;
+			}
+			chunk = chunk * 10 + digit;
+			scale *= 10;
+		}
+		mulAddSmall(m, scale, chunk);
+	}
+	trim(m);
+	out = make(m, neg);
+	return true;
+}
+
+std::vector<std::uint32_t> Integer::magnitude() const {
+	if (_limbs != nullptr) {
+		return Mag(_limbs + 1, _limbs + 1 + _limbs[0]);
+	}
+	// Negate in unsigned arithmetic so that the most negative value works.
+	unsigned long long u = static_cast<unsigned long long>(_value);
+	return magOf(_value < 0 ? 0 - u : u);
+}
+
+std::uint64_t Integer::hash() const {
+	if (_limbs == nullptr) {
+		return hashMix(0, static_cast<std::uint64_t>(_value));
+	}
+	std::uint64_t h = hashMix(1, static_cast<std::uint64_t>(_value));
+	for (std::uint32_t i = 1; i <= _limbs[0]; ++i) {
+		h = hashMix(h, _limbs[i]);
+	}
+	return h;
+}
+
+std::string Integer::str() const {
+	if (_limbs == nullptr) {
+		return std::to_string(_value);
+	}
+	// Peel off nine decimal digits at a time, least significant first.
+	Mag m = magnitude();
+	std::string digits;
+	while (!m.empty()) {
+		std::uint32_t chunk = divSmall(m, 1000000000);
+		for (int k = 0; k < 9 && (chunk != 0 || !m.empty()); ++k) {
+			digits.push_back(static_cast<char>('0' + chunk % 10));
+			chunk /= 10;
+		}
+	}
+	if (negative()) {
+		digits.push_back('-');
+	}
+	std::reverse(digits.begin(), digits.end());
+	return digits;
+}
+
+Integer Integer::operator-() const {
+	if (_limbs == nullptr && _value != std::numeric_limits<long long>::min()) {
+		return Integer(-_value);
+	}
+	return make(magnitude(), !negative());
+}
+
+Integer Integer::add(const Integer& a, const Integer& b, bool subtract) {
+	bool na = a.negative();
+	bool nb = b.negative() != subtract;
+	Mag ma = a.magnitude();
+	Mag mb = b.magnitude();
+	if (na == nb) {
+		return make(addMag(ma, mb), na);
+	}
+	// The signs differ, so subtract the smaller magnitude from the larger.
+	if (compareMag(ma, mb) >= 0) {
+		return make(subMag(ma, mb), na);
+	}
+	return make(subMag(mb, ma), nb);
+}
+
+Integer Integer::multiply(const Integer& a, const Integer& b) {
+	return make(mulMag(a.magnitude(), b.magnitude()),
+		a.negative() != b.negative());
+}
+
+Integer Integer::remainder(const Integer& a, const Integer& b) {
+	return make(remMag(a.magnitude(), b.magnitude()), a.negative());
+}
+
+int Integer::compareLarge(const Integer& a, const Integer& b) {
+	if (a.negative() != b.negative()) {
+		return a.negative() ? -1 : 1;
+	}
+	int c = compareMag(a.magnitude(), b.magnitude());
+	return a.negative() ? -c : c;
+}
@@ -0,0 +1,141 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef INTEGER_H
+#define INTEGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// An integer has arbitrary precision. Values that fit in 64 bits are stored
+// inline, and arithmetic on them is a machine operation plus an overflow check.
+// Larger values spill to an array of 32-bit limbs allocated with allocNode, so
+// they live in the current arena like the nodes that own them. The inline form
+// is always used when the value fits, so each value has one representation.
+class Integer {
+public:
+	Integer(long long x = 0) : _value(x), _limbs(nullptr) {}
+	Integer(const Integer& other);
+	Integer(Integer&& other) : _value(other._value), _limbs(other._limbs) {
+		other._limbs = nullptr;
+	}
+	Integer& operator=(Integer other);
+	~Integer();
+
+	// Parses an optional sign followed by one or more decimal digits. Returns
+	// false if [begin, end) is not of that form.
+	static bool parse(const char* begin, const char* end, Integer& out);
+
+	// Creates an integer from its magnitude (given as 32-bit limbs, least
+	// significant first) and its sign.
+	static Integer fromMagnitude(const std::uint32_t* limbs, std::size_t n,
+		bool negative);
+
+	// Returns true if the value fits in 64 bits, and returns that value.
+	bool isSmall() const { return _limbs == nullptr; }
+	long long small() const { return _value; }
+
+	// Returns true if the value is less than zero.
+	bool negative() const { return _value < 0; }
+
+	// Returns the magnitude as 32-bit limbs, least significant first. Zero has
+	// no limbs.
+	std::vector<std::uint32_t> magnitude() const;
+
+	// Returns a 64-bit hash of the value.
+	std::uint64_t hash() const;
+
+	// Returns the decimal representation of the value.
+	std::string str() const;
+
+	Integer operator-() const;
+	friend Integer operator+(const Integer& a, const Integer& b);
+	friend Integer operator-(const Integer& a, const Integer& b);
+	friend Integer operator*(const Integer& a, const Integer& b);
+
+	// Returns the remainder of dividing a by b, which has the sign of a (like
+	// the built-in operator). Assumes b is not zero.
+	friend Integer operator%(const Integer& a, const Integer& b);
+
+	// Returns a negative number, zero, or a positive number if a is less than,
+	// equal to, or greater than b.
+	static int compare(const Integer& a, const Integer& b) {
+		if (a.isSmall() && b.isSmall()) {
+			return (a._value > b._value) - (a._value < b._value);
+		}
+		return compareLarge(a, b);
+	}
+
+	friend std::ostream& operator<<(std::ostream& s, const Integer& x) {
+		return x.isSmall() ? s << x._value : s << x.str();
+	}
+
+private:
+	// The slow paths, used when an operand is large or the result overflows.
+	static Integer add(const Integer& a, const Integer& b, bool subtract);
+	static Integer multiply(const Integer& a, const Integer& b);
+	static Integer remainder(const Integer& a, const Integer& b);
+	static int compareLarge(const Integer& a, const Integer& b);
+
+	long long _value; // the value if small, otherwise the sign (1 or -1)
+	std::uint32_t* _limbs; // null if small, otherwise the count and limbs
+};
+
+inline Integer operator+(const Integer& a, const Integer& b) {
+	long long r;
+	if (a.isSmall() && b.isSmall()
+			&& !__builtin_add_overflow(a._value, b._value, &r)) {
+		return Integer(r);
+	}
+	return Integer::add(a, b, false);
+}
+
+inline Integer operator-(const Integer& a, const Integer& b) {
+	long long r;
+	if (a.isSmall() && b.isSmall()
+			&& !__builtin_sub_overflow(a._value, b._value, &r)) {
+		return Integer(r);
+	}
+	return Integer::add(a, b, true);
+}
+
+inline Integer operator*(const Integer& a, const Integer& b) {
+	long long r;
+	if (a.isSmall() && b.isSmall()
+			&& !__builtin_mul_overflow(a._value, b._value, &r)) {
+		return Integer(r);
+	}
+	return Integer::multiply(a, b);
+}
+
+inline Integer operator%(const Integer& a, const Integer& b) {
+	// Dividing the most negative value by -1 overflows, so that takes the slow
+	// path as well.
+	if (a.isSmall() && b.isSmall() && b._value != -1) {
+		return Integer(a._value % b._value);
+	}
+	return Integer::remainder(a, b);
+}
+
+inline bool operator==(const Integer& a, const Integer& b) {
+	return Integer::compare(a, b) == 0;
+}
+inline bool operator!=(const Integer& a, const Integer& b) {
+	return Integer::compare(a, b) != 0;
+}
+inline bool operator<(const Integer& a, const Integer& b) {
+	return Integer::compare(a, b) < 0;
+}
+inline bool operator<=(const Integer& a, const Integer& b) {
+	return Integer::compare(a, b) <= 0;
+}
+inline bool operator>(const Integer& a, const Integer& b) {
+	return Integer::compare(a, b) > 0;
+}
+inline bool operator>=(const Integer& a, const Integer& b) {
+	return Integer::compare(a, b) >= 0;
+}
+
+#endif
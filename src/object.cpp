@@ -2,12 +2,66 @@
 
 #include "object.hpp"
 
+#include "encode.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// The number of integers at which a concrete set switches to a bitmap.
+const std::size_t bitmap_min = 4096;
+
+// Bitmaps store 32-bit signed integers offset so that the order is preserved.
+const std::uint32_t bitmap_offset = 0x80000000u;
+
+// Returns true if the sorted integers can all be stored in a bitmap.
+bool fitsBitmap(const NodeVec<long long>& ints) {
+	return ints.empty() || (ints.front() >= std::numeric_limits<int>::min()
+		&& ints.back() <= std::numeric_limits<int>::max());
+}
+
+// Converts sorted integers that fit into a bitmap.
+Bitmap toBitmap(const NodeVec<long long>& ints) {
+	std::vector<std::uint32_t> keys;
+	keys.reserve(ints.size());
+	for (long long x: ints) {
+		keys.push_back(static_cast<std::uint32_t>(x) ^ bitmap_offset);
+	}
+	return Bitmap::fromSorted(keys.data(), keys.size());
+}
+
+}
+
 // =============================================================================
 //            Object
 // =============================================================================
 
 Object::~Object() {}
 
+// Objects with no operands have no symbols to bind or replace.
+void Object::abstract(unsigned int, unsigned int) {}
+
+Object* Object::substitute(unsigned int, const Object&) {
+	return nullptr;
+}
+
+Object* Object::bindValues(const Env&) const {
+	return nullptr;
+}
+
+bool Object::evaluate(Integer&, const Env&) const {
+	return false;
+}
+
 std::ostream& operator<<(std::ostream& stream, const Object& obj) {
 	return obj.print(stream);
 }
@@ -20,18 +74,52 @@ Object* Number::clone() const {
 	return cloneSelf();
 }
 
-ConcreteNumber::ConcreteNumber(int x) : _x(x) {}
+Number* Number::fold() {
+	return nullptr;
+}
+
+ConcreteNumber::ConcreteNumber(Integer x)
+	: Number(CONCRETE_NUMBER), _x(std::move(x)) {}
 
 std::ostream& ConcreteNumber::print(std::ostream& s) const {
 	return s << _x;
 }
 
+void ConcreteNumber::encode(Encoder& e) const {
+	typedef std::numeric_limits<std::int32_t> Limits;
+	if (_x.isSmall() && _x.small() >= Limits::min()
+			&& _x.small() <= Limits::max()) {
+		e.node(FLAT_NUMBER, 0, false, static_cast<std::uint32_t>(_x.small()));
+		return;
+	}
+	std::vector<std::uint32_t> limbs = _x.magnitude();
+	for (std::uint32_t limb: limbs) {
+		e.node(FLAT_LIMB, 0, false, limb);
+	}
+	e.node(FLAT_BIG_NUMBER, 0, _x.negative(),
+		static_cast<std::uint32_t>(limbs.size()));
+}
+
+bool ConcreteNumber::equalSelf(const Object& other) const {
+	auto n = objectCast<ConcreteNumber>(&other);
+	return n != nullptr && n->_x == _x;
+}
+
+std::uint64_t ConcreteNumber::computeHash() const {
+	return hashMix(FLAT_NUMBER, _x.hash());
+}
+
+bool ConcreteNumber::evaluate(Integer& out, const Env&) const {
+	out = _x;
+	return true;
+}
+
 Number* ConcreteNumber::cloneSelf() const {
 	return new ConcreteNumber(_x);
 }
 
-CompoundNumber::CompoundNumber(Type t, Number* a, Number* b)
-	: _type(t), _a(a), _b(b) {}
+CompoundNumber::CompoundNumber(Type t, Object* a, Object* b)
+	: Number(COMPOUND_NUMBER), _type(t), _a(a), _b(b) {}
 
 CompoundNumber::~CompoundNumber() {
 	delete _a;
@@ -39,28 +127,88 @@ CompoundNumber::~CompoundNumber() {
 }
 
 Number* CompoundNumber::cloneSelf() const {
-	return new CompoundNumber(_type, _a->cloneSelf(), _b->cloneSelf());
+	return new CompoundNumber(_type, _a->clone(), _b->clone());
 }
 
-std::ostream& CompoundNumber::print(std::ostream& s) const {
-	s << '(';
+Number* CompoundNumber::fold() {
+	foldInto(_a);
+	foldInto(_b);
+	_hash = 0;
+	Integer x;
+	if (evaluate(x, Env())) {
+		return new ConcreteNumber(std::move(x));
+	}
+	return nullptr;
+}
+
+void CompoundNumber::abstract(unsigned int id, unsigned int depth) {
+	_a->abstract(id, depth);
+	_b->abstract(id, depth);
+	_hash = 0;
+}
+
+Object* CompoundNumber::substitute(unsigned int depth, const Object& term) {
+	substituteInto(_a, depth, term);
+	substituteInto(_b, depth, term);
+	_hash = 0;
+	return nullptr;
+}
+
+Object* CompoundNumber::bindValues(const Env& env) const {
+	Object* a = _a->bindValues(env);
+	Object* b = _b->bindValues(env);
+	if (a == nullptr && b == nullptr) {
+		return nullptr;
+	}
+	return new CompoundNumber(_type, a != nullptr ? a : _a->clone(),
+		b != nullptr ? b : _b->clone());
+}
+
+bool CompoundNumber::evaluate(Integer& out, const Env& env) const {
+	Integer a, b;
+	if (!_a->evaluate(a, env) || !_b->evaluate(b, env)) {
+		return false;
+	}
 	switch (_type) {
-	case ADD: s << '+'; break;
-	case SUB: s << '-'; break;
-	case MUL: s << '*'; break;
+	case ADD: out = a + b; break;
+	case SUB: out = a - b; break;
+	case MUL: out = a * b; break;
 	}
-	s << ' ';
+	return true;
+}
+
+const char* CompoundNumber::name(Type t) {
+	switch (t) {
+	case ADD: return "+";
+	case SUB: return "-";
+	case MUL: return "*";
+	}
+	return "";
+}
+
+std::ostream& CompoundNumber::print(std::ostream& s) const {
+	s << '(' << name(_type) << ' ';
 	_a->print(s);
 	s << ' ';
 	_b->print(s);
 	return s << ')';
 }
 
-int CompoundNumber::getType(const std::string& s) {
-	if (s == "+") return ADD;
-	if (s == "-") return SUB;
-	if (s == "*") return MUL;
-	return -1;
+void CompoundNumber::encode(Encoder& e) const {
+	_a->encode(e);
+	_b->encode(e);
+	e.node(FLAT_COMPOUND_NUMBER, _type, false, 0);
+}
+
+bool CompoundNumber::equalSelf(const Object& other) const {
+	auto n = objectCast<CompoundNumber>(&other);
+	return n != nullptr && n->_type == _type
+		&& n->_a->equal(*_a) && n->_b->equal(*_b);
+}
+
+std::uint64_t CompoundNumber::computeHash() const {
+	std::uint64_t h = hashMix(FLAT_COMPOUND_NUMBER, _type);
+	return hashMix(hashMix(h, _a->hash()), _b->hash());
 }
 
 // =============================================================================
@@ -71,19 +219,326 @@ Object* Set::clone() const {
 	return cloneSelf();
 }
 
-ConcreteSet::ConcreteSet(std::vector<Object*> items) : _items(items) {}
+Set* Set::fold() {
+	return nullptr;
+}
+
+ConcreteSet::ConcreteSet(std::vector<Object*> items) : Set(CONCRETE_SET) {
+	insert(items);
+}
+
+void ConcreteSet::insert(std::vector<Object*>& items) {
+	// Unbox the small integers, and collect everything else.
+	items.insert(items.begin(), _others.begin(), _others.end());
+	std::vector<Object*> candidates;
+	std::vector<long long> fresh;
+	for (Object* obj: items) {
+		auto n = objectCast<ConcreteNumber>(obj);
+		if (n != nullptr && n->value().isSmall()) {
+			fresh.push_back(n->value().small());
+			delete obj;
+		} else {
+			candidates.push_back(obj);
+		}
+	}
+	if (!fresh.empty()) {
+		std::vector<long long> all = integers();
+		all.insert(all.end(), fresh.begin(), fresh.end());
+		std::sort(all.begin(), all.end());
+		all.erase(std::unique(all.begin(), all.end()), all.end());
+		_ints.assign(all.begin(), all.end());
+		_bits = Bitmap();
+		pack();
+	}
+
+	// Sort the candidates by hash (breaking ties by position) so that the
+	// duplicates of each element follow it, and keep only the first of each.
+	std::vector<Entry> order;
+	order.reserve(candidates.size());
+	for (std::size_t i = 0; i < candidates.size(); ++i) {
+		order.emplace_back(candidates[i]->hash(), static_cast<std::uint32_t>(i));
+	}
+	std::sort(order.begin(), order.end());
+	std::vector<bool> keep(candidates.size(), true);
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		for (std::size_t j = i; j-- > 0 && order[j].first == order[i].first;) {
+			if (keep[order[j].second] && candidates[order[j].second]->equal(
+					*candidates[order[i].second])) {
+				keep[order[i].second] = false;
+				break;
+			}
+		}
+	}
+
+	// Rebuild the elements in their original order, then the index.
+	_others.clear();
+	for (std::size_t i = 0; i < candidates.size(); ++i) {
+		if (keep[i]) {
+			_others.push_back(candidates[i]);
+		} else {
+			delete candidates[i];
+		}
+	}
+	_index.clear();
+	_index.reserve(_others.size());
+	for (std::size_t i = 0; i < _others.size(); ++i) {
+		_index.emplace_back(_others[i]->hash(), static_cast<std::uint32_t>(i));
+	}
+	std::sort(_index.begin(), _index.end());
+	_hash = 0;
+}
+
+void ConcreteSet::pack() {
+	if (usesBitmap() && _bits.size() < bitmap_min) {
+		std::vector<long long> all = integers();
+		_ints.assign(all.begin(), all.end());
+		_bits = Bitmap();
+	} else if (_ints.size() >= bitmap_min && fitsBitmap(_ints)) {
+		_bits = toBitmap(_ints);
+		NodeVec<long long>().swap(_ints);
+	}
+}
+
+std::vector<long long> ConcreteSet::integers() const {
+	if (!usesBitmap()) {
+		return std::vector<long long>(_ints.begin(), _ints.end());
+	}
+	std::vector<std::uint32_t> keys;
+	keys.reserve(_bits.size());
+	_bits.values(keys);
+	std::vector<long long> result;
+	result.reserve(keys.size());
+	for (std::uint32_t k: keys) {
+		result.push_back(static_cast<int>(k ^ bitmap_offset));
+	}
+	return result;
+}
+
+std::pair<const ConcreteSet::Entry*, const ConcreteSet::Entry*>
+ConcreteSet::lookup(std::uint64_t h) const {
+	const Entry* begin = _index.data();
+	const Entry* end = begin + _index.size();
+	const Entry* lo = std::lower_bound(begin, end, Entry(h, 0));
+	const Entry* hi = lo;
+	while (hi != end && hi->first == h) {
+		++hi;
+	}
+	return std::make_pair(lo, hi);
+}
+
+bool ConcreteSet::contains(long long x) const {
+	if (usesBitmap()) {
+		return x >= std::numeric_limits<int>::min()
+			&& x <= std::numeric_limits<int>::max()
+			&& _bits.contains(static_cast<std::uint32_t>(x) ^ bitmap_offset);
+	}
+	return std::binary_search(_ints.begin(), _ints.end(), x);
+}
+
+bool ConcreteSet::contains(const Object& obj) const {
+	auto n = objectCast<ConcreteNumber>(&obj);
+	if (n != nullptr && n->value().isSmall()) {
+		return contains(n->value().small());
+	}
+	auto range = lookup(obj.hash());
+	for (const Entry* e = range.first; e != range.second; ++e) {
+		if (_others[e->second]->equal(obj)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ConcreteSet::subsetOf(const ConcreteSet& other) const {
+	if (size() > other.size()) {
+		return false;
+	}
+	if (usesBitmap() && other.usesBitmap()) {
+		if (!_bits.subsetOf(other._bits)) {
+			return false;
+		}
+	} else if (!usesBitmap() && !other.usesBitmap()) {
+		if (!std::includes(other._ints.begin(), other._ints.end(),
+				_ints.begin(), _ints.end())) {
+			return false;
+		}
+	} else {
+		for (long long x: integers()) {
+			if (!other.contains(x)) {
+				return false;
+			}
+		}
+	}
+	// Both indexes are sorted by hash, so walk them together.
+	std::size_t j = 0;
+	for (const Entry& e: _index) {
+		while (j < other._index.size() && other._index[j].first < e.first) {
+			++j;
+		}
+		bool found = false;
+		for (std::size_t k = j;
+				k < other._index.size() && other._index[k].first == e.first; ++k) {
+			if (other._others[other._index[k].second]->equal(
+					*_others[e.second])) {
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			return false;
+		}
+	}
+	return true;
+}
 
 Set* ConcreteSet::cloneSelf() const {
-	std::vector<Object*> v;
-	v.reserve(_items.size());
-	for (Object* obj: _items) {
-		v.push_back(obj->clone());
+	ConcreteSet* set = new ConcreteSet();
+	set->_ints = _ints;
+	set->_bits = _bits;
+	set->_others.reserve(_others.size());
+	for (const Object* obj: _others) {
+		set->_others.push_back(obj->clone());
+	}
+	set->_index = _index;
+	return set;
+}
+
+template <typename BitOp, typename ArrayOp>
+void ConcreteSet::combineInts(const ConcreteSet& a, const ConcreteSet& b,
+		BitOp bitOp, ArrayOp arrayOp) {
+	bool aFits = a.usesBitmap() || fitsBitmap(a._ints);
+	bool bFits = b.usesBitmap() || fitsBitmap(b._ints);
+	if ((a.usesBitmap() || b.usesBitmap()) && aFits && bFits) {
+		// Convert the smaller side if necessary and use the bitmap kernels.
+		Bitmap aTemp, bTemp;
+		const Bitmap* aBits = &a._bits;
+		const Bitmap* bBits = &b._bits;
+		if (!a.usesBitmap()) {
+			aTemp = toBitmap(a._ints);
+			aBits = &aTemp;
+		}
+		if (!b.usesBitmap()) {
+			bTemp = toBitmap(b._ints);
+			bBits = &bTemp;
+		}
+		_bits = bitOp(*aBits, *bBits);
+	} else {
+		std::vector<long long> x = a.integers();
+		std::vector<long long> y = b.integers();
+		std::vector<long long> out;
+		arrayOp(x, y, out);
+		_ints.assign(out.begin(), out.end());
+	}
+	pack();
+}
+
+ConcreteSet* ConcreteSet::unite(const ConcreteSet& other) const {
+	ConcreteSet* set = new ConcreteSet();
+	set->combineInts(*this, other, Bitmap::unite,
+		[](const std::vector<long long>& x, const std::vector<long long>& y,
+				std::vector<long long>& out) {
+			std::set_union(x.begin(), x.end(), y.begin(), y.end(),
+				std::back_inserter(out));
+		});
+	std::vector<Object*> items;
+	for (const Object* obj: _others) {
+		items.push_back(obj->clone());
+	}
+	for (const Object* obj: other._others) {
+		items.push_back(obj->clone());
+	}
+	set->insert(items);
+	return set;
+}
+
+ConcreteSet* ConcreteSet::intersect(const ConcreteSet& other) const {
+	ConcreteSet* set = new ConcreteSet();
+	set->combineInts(*this, other, Bitmap::intersect,
+		[](const std::vector<long long>& x, const std::vector<long long>& y,
+				std::vector<long long>& out) {
+			std::set_intersection(x.begin(), x.end(), y.begin(), y.end(),
+				std::back_inserter(out));
+		});
+	std::vector<Object*> items;
+	for (const Object* obj: _others) {
+		if (other.contains(*obj)) {
+			items.push_back(obj->clone());
+		}
+	}
+	set->insert(items);
+	return set;
+}
+
+ConcreteSet* ConcreteSet::subtract(const ConcreteSet& other) const {
+	ConcreteSet* set = new ConcreteSet();
+	set->combineInts(*this, other, Bitmap::subtract,
+		[](const std::vector<long long>& x, const std::vector<long long>& y,
+				std::vector<long long>& out) {
+			std::set_difference(x.begin(), x.end(), y.begin(), y.end(),
+				std::back_inserter(out));
+		});
+	std::vector<Object*> items;
+	for (const Object* obj: _others) {
+		if (!other.contains(*obj)) {
+			items.push_back(obj->clone());
+		}
+	}
+	set->insert(items);
+	return set;
+}
+
+Set* ConcreteSet::fold() {
+	// Folding can turn elements into integers or make them equal, so the
+	// canonical form has to be rebuilt.
+	for (Object*& obj: _others) {
+		foldInto(obj);
+	}
+	std::vector<Object*> items;
+	insert(items);
+	return nullptr;
+}
+
+// Binding and substitution change the hashes of the elements (and can make
+// them equal), so the canonical form has to be rebuilt, as in fold.
+void ConcreteSet::abstract(unsigned int id, unsigned int depth) {
+	for (Object* obj: _others) {
+		obj->abstract(id, depth);
+	}
+	std::vector<Object*> items;
+	insert(items);
+}
+
+Object* ConcreteSet::substitute(unsigned int depth, const Object& term) {
+	for (Object*& obj: _others) {
+		substituteInto(obj, depth, term);
 	}
-	return new ConcreteSet(v);
+	std::vector<Object*> items;
+	insert(items);
+	return nullptr;
+}
+
+Object* ConcreteSet::bindValues(const Env& env) const {
+	ConcreteSet* copy = nullptr;
+	for (std::size_t i = 0; i < _others.size(); ++i) {
+		Object* obj = _others[i]->bindValues(env);
+		if (obj == nullptr) {
+			continue;
+		}
+		if (copy == nullptr) {
+			copy = objectCast<ConcreteSet>(cloneSelf());
+		}
+		delete copy->_others[i];
+		copy->_others[i] = obj;
+	}
+	if (copy != nullptr) {
+		std::vector<Object*> items;
+		copy->insert(items);
+	}
+	return copy;
 }
 
 ConcreteSet::~ConcreteSet() {
-	for (Object* obj: _items) {
+	for (Object* obj: _others) {
 		delete obj;
 	}
 }
@@ -91,7 +546,15 @@ ConcreteSet::~ConcreteSet() {
 std::ostream& ConcreteSet::print(std::ostream& s) const {
 	s << '{';
 	bool first = true;
-	for (const Object* obj: _items) {
+	for (long long x: integers()) {
+		if (first) {
+			first = false;
+		} else {
+			s << ", ";
+		}
+		s << x;
+	}
+	for (const Object* obj: _others) {
 		if (first) {
 			first = false;
 		} else {
@@ -102,30 +565,268 @@ std::ostream& ConcreteSet::print(std::ostream& s) const {
 	return s << '}';
 }
 
-SpecialSet::SpecialSet(Type t) : _type(t) {}
+void ConcreteSet::encode(Encoder& e) const {
+	for (long long x: integers()) {
+		ConcreteNumber(x).encode(e);
+	}
+	for (const Object* obj: _others) {
+		obj->encode(e);
+	}
+	e.node(FLAT_CONCRETE_SET, 0, false, static_cast<std::uint32_t>(size()));
+}
+
+bool ConcreteSet::equalSelf(const Object& other) const {
+	auto set = objectCast<ConcreteSet>(&other);
+	// The integer representation depends only on the values, so the arrays
+	// and bitmaps can be compared directly.
+	return set != nullptr && set->size() == size() && set->_ints == _ints
+		&& set->_bits == _bits && subsetOf(*set);
+}
+
+std::uint64_t ConcreteSet::computeHash() const {
+	std::uint64_t h = hashMix(FLAT_CONCRETE_SET, size());
+	for (long long x: integers()) {
+		h = hashMix(h, Integer(x).hash());
+	}
+	// Combine the other elements in a way that does not depend on order.
+	std::uint64_t sum = 0;
+	for (const Object* obj: _others) {
+		sum += hashMix(0, obj->hash());
+	}
+	return hashMix(h, sum);
+}
+
+const long long RangeSet::MIN;
+const long long RangeSet::MAX;
+
+// Sorts the intervals and merges the ones that overlap or touch, dropping the
+// empty ones.
+static void normalize(std::vector<RangeSet::Interval>& v) {
+	v.erase(std::remove_if(v.begin(), v.end(),
+		[](const RangeSet::Interval& i) { return i.first > i.second; }),
+		v.end());
+	std::sort(v.begin(), v.end());
+	std::size_t n = 0;
+	for (const RangeSet::Interval& i: v) {
+		if (n > 0 && (v[n-1].second == RangeSet::MAX
+				|| v[n-1].second + 1 >= i.first)) {
+			v[n-1].second = std::max(v[n-1].second, i.second);
+		} else {
+			v[n++] = i;
+		}
+	}
+	v.resize(n);
+}
+
+// Returns the intervals of integers not in any of the given ones.
+static std::vector<RangeSet::Interval> complement(
+		const NodeVec<RangeSet::Interval>& v) {
+	std::vector<RangeSet::Interval> gaps;
+	long long next = RangeSet::MIN;
+	for (const RangeSet::Interval& i: v) {
+		if (i.first > next) {
+			gaps.emplace_back(next, i.first - 1);
+		}
+		if (i.second == RangeSet::MAX) {
+			return gaps;
+		}
+		next = i.second + 1;
+	}
+	gaps.emplace_back(next, RangeSet::MAX);
+	return gaps;
+}
+
+// Returns the intervals of integers in both of the given lists.
+template <typename A, typename B>
+static std::vector<RangeSet::Interval> overlap(const A& a, const B& b) {
+	std::vector<RangeSet::Interval> result;
+	auto i = a.begin();
+	auto j = b.begin();
+	while (i != a.end() && j != b.end()) {
+		long long lo = std::max(i->first, j->first);
+		long long hi = std::min(i->second, j->second);
+		if (lo <= hi) {
+			result.emplace_back(lo, hi);
+		}
+		if (i->second < j->second) {
+			++i;
+		} else {
+			++j;
+		}
+	}
+	return result;
+}
+
+RangeSet::RangeSet(std::vector<Interval> intervals) : Set(RANGE_SET) {
+	normalize(intervals);
+	_intervals.assign(intervals.begin(), intervals.end());
+}
+
+RangeSet::RangeSet(long long lo, long long hi)
+	: RangeSet(std::vector<Interval>{Interval(lo, hi)}) {}
+
+Set* RangeSet::cloneSelf() const {
+	return new RangeSet(std::vector<Interval>(
+		_intervals.begin(), _intervals.end()));
+}
+
+RangeSet* RangeSet::fromSet(const Object& set) {
+	if (auto range = objectCast<RangeSet>(&set)) {
+		return static_cast<RangeSet*>(range->cloneSelf());
+	}
+	if (auto special = objectCast<SpecialSet>(&set)) {
+		switch (special->type()) {
+		case SpecialSet::EMPTY:
+			return new RangeSet(std::vector<Interval>());
+		case SpecialSet::INTEGERS:
+			return new RangeSet(MIN, MAX);
+		default:
+			return nullptr;
+		}
+	}
+	auto concrete = objectCast<ConcreteSet>(&set);
+	if (concrete == nullptr || !concrete->others().empty()) {
+		return nullptr;
+	}
+	// The integers are sorted, so consecutive runs become intervals.
+	std::vector<Interval> intervals;
+	for (long long x: concrete->integers()) {
+		if (!intervals.empty() && intervals.back().second + 1 == x) {
+			intervals.back().second = x;
+		} else {
+			intervals.emplace_back(x, x);
+		}
+	}
+	return new RangeSet(intervals);
+}
+
+bool RangeSet::contains(long long x) const {
+	// Find the last interval starting at or before x.
+	auto iter = std::upper_bound(_intervals.begin(), _intervals.end(),
+		Interval(x, MAX));
+	return iter != _intervals.begin() && (iter - 1)->second >= x;
+}
+
+bool RangeSet::contains(const Object& obj) const {
+	auto n = objectCast<ConcreteNumber>(&obj);
+	return n != nullptr && n->value().isSmall() && contains(n->value().small());
+}
+
+bool RangeSet::bounded() const {
+	return _intervals.empty() || (_intervals.front().first != MIN
+		&& _intervals.back().second != MAX);
+}
+
+bool RangeSet::subsetOf(const RangeSet& other) const {
+	// Each interval must lie within a single interval of the other set, since
+	// the other set's intervals don't touch.
+	auto j = other._intervals.begin();
+	for (const Interval& i: _intervals) {
+		while (j != other._intervals.end() && j->second < i.first) {
+			++j;
+		}
+		if (j == other._intervals.end() || j->first > i.first
+				|| j->second < i.second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+RangeSet* RangeSet::unite(const RangeSet& other) const {
+	std::vector<Interval> v(_intervals.begin(), _intervals.end());
+	v.insert(v.end(), other._intervals.begin(), other._intervals.end());
+	return new RangeSet(v);
+}
+
+RangeSet* RangeSet::intersect(const RangeSet& other) const {
+	return new RangeSet(overlap(_intervals, other._intervals));
+}
+
+RangeSet* RangeSet::subtract(const RangeSet& other) const {
+	return new RangeSet(overlap(_intervals, complement(other._intervals)));
+}
+
+std::ostream& RangeSet::print(std::ostream& s) const {
+	// Every interval is printed with an ellipsis, even a single integer, so
+	// that the output parses back to a range set.
+	s << '{';
+	bool first = true;
+	for (const Interval& i: _intervals) {
+		if (first) {
+			first = false;
+		} else {
+			s << ", ";
+		}
+		if (i.first != MIN) {
+			s << i.first << ", ";
+		}
+		s << "...";
+		if (i.second != MAX) {
+			s << ", " << i.second;
+		}
+	}
+	return s << '}';
+}
+
+void RangeSet::encode(Encoder& e) const {
+	for (const Interval& i: _intervals) {
+		ConcreteNumber(i.first).encode(e);
+		ConcreteNumber(i.second).encode(e);
+	}
+	e.node(FLAT_RANGE_SET, 0, false,
+		static_cast<std::uint32_t>(_intervals.size()));
+}
+
+bool RangeSet::equalSelf(const Object& other) const {
+	auto set = objectCast<RangeSet>(&other);
+	return set != nullptr && set->_intervals == _intervals;
+}
+
+std::uint64_t RangeSet::computeHash() const {
+	std::uint64_t h = hashMix(FLAT_RANGE_SET, _intervals.size());
+	for (const Interval& i: _intervals) {
+		h = hashMix(h, static_cast<std::uint64_t>(i.first));
+		h = hashMix(h, static_cast<std::uint64_t>(i.second));
+	}
+	return h;
+}
+
+SpecialSet::SpecialSet(Type t) : Set(SPECIAL_SET), _type(t) {}
 
 Set* SpecialSet::cloneSelf() const {
 	return new SpecialSet(_type);
 }
 
-std::ostream& SpecialSet::print(std::ostream& s) const {
-	switch(_type) {
-	case EMPTY: return s << "null";
-	case INTEGERS: return s << "ZZ";
-	case NATURALS: return s << "NN";
-	case SETS: return s << "SS";
+const char* SpecialSet::name(Type t) {
+	switch (t) {
+	case EMPTY: return "null";
+	case INTEGERS: return "ZZ";
+	case NATURALS: return "NN";
+	case SETS: return "SS";
 	}
+	return "";
+}
+
+std::ostream& SpecialSet::print(std::ostream& s) const {
+	return s << name(_type);
+}
+
+void SpecialSet::encode(Encoder& e) const {
+	e.node(FLAT_SPECIAL_SET, _type, false, 0);
+}
+
+bool SpecialSet::equalSelf(const Object& other) const {
+	auto set = objectCast<SpecialSet>(&other);
+	return set != nullptr && set->_type == _type;
 }
 
-int SpecialSet::getType(const std::string& s) {
-	if (s == "null") return EMPTY;
-	if (s == "ZZ") return INTEGERS;
-	if (s == "NN") return NATURALS;
-	if (s == "SS") return SETS;
-	return -1;
+std::uint64_t SpecialSet::computeHash() const {
+	return hashMix(FLAT_SPECIAL_SET, _type);
 }
 
-CompoundSet::CompoundSet(Type t, Set* a, Set* b) : _type(t), _a(a), _b(b) {}
+CompoundSet::CompoundSet(Type t, Object* a, Object* b)
+	: Set(COMPOUND_SET), _type(t), _a(a), _b(b) {}
 
 CompoundSet::~CompoundSet() {
 	delete _a;
@@ -133,28 +834,112 @@ CompoundSet::~CompoundSet() {
 }
 
 Set* CompoundSet::cloneSelf() const {
-	return new CompoundSet(_type, _a->cloneSelf(), _b->cloneSelf());
+	return new CompoundSet(_type, _a->clone(), _b->clone());
 }
 
-std::ostream& CompoundSet::print(std::ostream& s) const {
-	s << '(';
+Set* CompoundSet::fold() {
+	foldInto(_a);
+	foldInto(_b);
+	_hash = 0;
+	auto a = objectCast<ConcreteSet>(_a);
+	auto b = objectCast<ConcreteSet>(_b);
+	if (a == nullptr || b == nullptr) {
+		return foldRanges();
+	}
+	// Symbols in the operands might stand for integers, so intersections and
+	// differences are only evaluated when both operands are all integers.
 	switch (_type) {
-	case UNION: s << "union"; break;
-	case INTERSECT: s << "intersect"; break;
-	case DIFF: s << "diff"; break;
+	case UNION:
+		return a->unite(*b);
+	case INTERSECT:
+		if (a->others().empty() && b->others().empty()) {
+			return a->intersect(*b);
+		}
+		break;
+	case DIFF:
+		if (a->others().empty() && b->others().empty()) {
+			return a->subtract(*b);
+		}
+		break;
 	}
-	s << ' ';
+	return nullptr;
+}
+
+void CompoundSet::abstract(unsigned int id, unsigned int depth) {
+	_a->abstract(id, depth);
+	_b->abstract(id, depth);
+	_hash = 0;
+}
+
+Object* CompoundSet::substitute(unsigned int depth, const Object& term) {
+	substituteInto(_a, depth, term);
+	substituteInto(_b, depth, term);
+	_hash = 0;
+	return nullptr;
+}
+
+Object* CompoundSet::bindValues(const Env& env) const {
+	Object* a = _a->bindValues(env);
+	Object* b = _b->bindValues(env);
+	if (a == nullptr && b == nullptr) {
+		return nullptr;
+	}
+	return new CompoundSet(_type, a != nullptr ? a : _a->clone(),
+		b != nullptr ? b : _b->clone());
+}
+
+Set* CompoundSet::foldRanges() const {
+	if (objectCast<RangeSet>(_a) == nullptr
+			&& objectCast<RangeSet>(_b) == nullptr) {
+		return nullptr;
+	}
+	RangeSet* a = RangeSet::fromSet(*_a);
+	RangeSet* b = RangeSet::fromSet(*_b);
+	RangeSet* result = nullptr;
+	if (a != nullptr && b != nullptr) {
+		switch (_type) {
+		case UNION: result = a->unite(*b); break;
+		case INTERSECT: result = a->intersect(*b); break;
+		case DIFF: result = a->subtract(*b); break;
+		}
+	}
+	delete a;
+	delete b;
+	return result;
+}
+
+const char* CompoundSet::name(Type t) {
+	switch (t) {
+	case UNION: return "union";
+	case INTERSECT: return "intersect";
+	case DIFF: return "diff";
+	}
+	return "";
+}
+
+std::ostream& CompoundSet::print(std::ostream& s) const {
+	s << '(' << name(_type) << ' ';
 	_a->print(s);
 	s << ' ';
 	_b->print(s);
 	return s << ')';
 }
 
-int CompoundSet::getType(const std::string& s) {
-	if (s == "union") return UNION;
-	if (s == "intersect") return INTERSECT;
-	if (s == "diff") return DIFF;
-	return -1;
+void CompoundSet::encode(Encoder& e) const {
+	_a->encode(e);
+	_b->encode(e);
+	e.node(FLAT_COMPOUND_SET, _type, false, 0);
+}
+
+bool CompoundSet::equalSelf(const Object& other) const {
+	auto set = objectCast<CompoundSet>(&other);
+	return set != nullptr && set->_type == _type
+		&& set->_a->equal(*_a) && set->_b->equal(*_b);
+}
+
+std::uint64_t CompoundSet::computeHash() const {
+	std::uint64_t h = hashMix(FLAT_COMPOUND_SET, _type);
+	return hashMix(hashMix(h, _a->hash()), _b->hash());
 }
 
 // =============================================================================
@@ -162,34 +947,140 @@ int CompoundSet::getType(const std::string& s) {
 // =============================================================================
 
 namespace {
-	unsigned int symbolCount = 0;
+	// Atomic so that sentences can be parsed on several threads at once.
+	std::atomic<unsigned int> symbolCount(0);
 	unsigned int genUniqueId() { return symbolCount++; }
+
+	// The intern table. The deque never moves its strings, so references to
+	// them stay valid after the lock is released.
+	std::mutex nameMutex;
+	std::unordered_map<std::string, unsigned int> nameIds;
+	std::deque<std::string> names;
+}
+
+unsigned int internName(const char* data, std::size_t size) {
+	std::string str(data, size);
+	std::lock_guard<std::mutex> lock(nameMutex);
+	auto iter = nameIds.find(str);
+	if (iter != nameIds.end()) {
+		return iter->second;
+	}
+	unsigned int name = static_cast<unsigned int>(names.size());
+	names.push_back(str);
+	nameIds.emplace(std::move(str), name);
+	return name;
+}
+
+const std::string& nameString(unsigned int name) {
+	std::lock_guard<std::mutex> lock(nameMutex);
+	return names[name];
+}
+
+const unsigned int SymMap::NONE;
+
+void SymMap::bind(unsigned int name, unsigned int id) {
+	if (name >= _ids.size()) {
+		_ids.resize(name + 1, NONE);
+	}
+	if (_ids[name] == NONE) {
+		_bound.push_back(name);
+	}
+	_ids[name] = id;
+}
+
+void SymMap::clear() {
+	for (unsigned int name: _bound) {
+		_ids[name] = NONE;
+	}
+	_bound.clear();
 }
 
-Symbol::Symbol(char c) : _c(c), _id(genUniqueId()) {}
+Symbol::Symbol(const char* name)
+	: Object(SYMBOL), _name(internName(name, std::strlen(name))),
+	_id(genUniqueId()), _index(0) {}
 
-Symbol::Symbol(char c, SymMap& symbols, bool fresh) : _c(c) {
+Symbol::Symbol(unsigned int name, SymMap& symbols, bool fresh)
+		: Object(SYMBOL), _name(name), _index(0) {
 	if (!fresh) {
-		auto iter = symbols.find(_c);
-		if (iter != symbols.end()) {
-			_id = iter->second;
+		_id = symbols.find(_name);
+		if (_id != SymMap::NONE) {
 			return;
 		}
 	}
 	_id = genUniqueId();
-	symbols[_c] = _id;
+	symbols.bind(_name, _id);
 }
 
-Symbol::Symbol(char c, unsigned int id) : _c(c),  _id(id) {}
+Symbol::Symbol(unsigned int name, unsigned int id, unsigned int index)
+	: Object(SYMBOL), _name(name), _id(id), _index(index) {}
 
 Symbol* Symbol::cloneSelf() const {
-	return new Symbol(_c, _id);
+	return new Symbol(_name, _id, _index);
 }
 
 Object* Symbol::clone() const {
 	return cloneSelf();
 }
 
+Symbol* Symbol::fresh() const {
+	return new Symbol(_name, genUniqueId(), 0);
+}
+
+Symbol* Symbol::fold() {
+	return nullptr;
+}
+
+void Symbol::abstract(unsigned int id, unsigned int depth) {
+	if (_index == 0 && _id == id) {
+		_index = depth;
+		_hash = 0;
+	}
+}
+
+Object* Symbol::substitute(unsigned int depth, const Object& term) {
+	if (_index == depth) {
+		return term.clone();
+	}
+	if (_index > depth) {
+		--_index;
+	}
+	return nullptr;
+}
+
+// A bound symbol with no value yet refers to the variable being bound, as in
+// (forall y in {(+ y 1)} ...). It becomes free, so that it never has a value.
+Object* Symbol::bindValues(const Env& env) const {
+	if (_index == 0) {
+		return nullptr;
+	}
+	const Object* value = env.find(_id);
+	return value != nullptr ? value->clone() : new Symbol(_name, _id, 0);
+}
+
+// Quantifiers only bind closed values (see bindValues), so the value has no
+// bound symbols of its own and can be evaluated in the same environment.
+bool Symbol::evaluate(Integer& out, const Env& env) const {
+	const Object* value = lookup(env);
+	return value != nullptr && value->evaluate(out, env);
+}
+
 std::ostream& Symbol::print(std::ostream& s) const {
-	return s << _c;
+	return s << nameString(_name);
+}
+
+void Symbol::encode(Encoder& e) const {
+	e.node(FLAT_SYMBOL, 0, _index != 0, e.binding(_name, _id));
+}
+
+bool Symbol::equalSelf(const Object& other) const {
+	auto sym = objectCast<Symbol>(&other);
+	return sym != nullptr && sym->_index == _index
+		&& (_index != 0 || sym->_id == _id);
+}
+
+// Bound symbols all hash alike, whatever their names and indices, so that the
+// flat encoding (which only records whether a symbol is bound) can reproduce
+// the hash. Which quantifier binds them is left to equality.
+std::uint64_t Symbol::computeHash() const {
+	return hashMix(FLAT_SYMBOL, _index == 0 ? _id : SymMap::NONE);
 }
@@ -3,53 +3,252 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include "arena.hpp"
+#include "bitmap.hpp"
+#include "integer.hpp"
+
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
-#include <map>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
-// A symbol map is a mapping from symbol characters to their identifiers.
-typedef std::map<char, unsigned int> SymMap;
+class Encoder;
+class Object;
+
+// Symbol names are interned in a global table, so that each distinct name is
+// stored once and referred to everywhere else by a small integer. Interning a
+// name returns its integer, and the string can be retrieved from the integer.
+// Both are safe to call from multiple threads.
+unsigned int internName(const char* data, std::size_t size);
+const std::string& nameString(unsigned int name);
+
+// A symbol map is a mapping from interned symbol names to their identifiers.
+// It is a flat vector indexed by name, so a lookup is one array access.
+class SymMap {
+public:
+	// Returned by find when the name is not bound.
+	static const unsigned int NONE = ~0u;
+
+	// Returns the identifier bound to the name, or NONE.
+	unsigned int find(unsigned int name) const {
+		return name < _ids.size() ? _ids[name] : NONE;
+	}
+
+	// Binds the name to the identifier, replacing any previous binding.
+	void bind(unsigned int name, unsigned int id);
+
+	// Removes all bindings. This only touches the names that were bound, so
+	// clearing and reusing a map is cheap no matter how many names exist.
+	void clear();
+
+private:
+	std::vector<unsigned int> _ids; // identifiers indexed by name
+	std::vector<unsigned int> _bound; // the names that have been bound
+};
+
+// An environment binds symbols to the objects they stand for while a sentence
+// is evaluated. Bindings are pushed and popped like a stack as quantifiers are
+// entered and left, and later bindings shadow earlier ones. The environment
+// does not own the objects. It also has a budget of steps, so that nested
+// quantifiers over large sets give up instead of running for a long time.
+class Env {
+public:
+	// Creates an environment with no bindings and the given budget.
+	explicit Env(std::size_t budget = 1 << 20) : _budget(budget) {}
+
+	// Uses up one step of the budget. Returns false if there are none left.
+	bool spend() {
+		if (_budget == 0) {
+			return false;
+		}
+		--_budget;
+		return true;
+	}
+
+	// Binds the symbol identifier to the value, or removes the latest binding.
+	void push(unsigned int id, const Object* value) {
+		_bindings.emplace_back(id, value);
+	}
+	void pop() { _bindings.pop_back(); }
+
+	// Returns the value bound to the symbol identifier, or null.
+	const Object* find(unsigned int id) const {
+		for (auto iter = _bindings.rbegin(); iter != _bindings.rend(); ++iter) {
+			if (iter->first == id) {
+				return iter->second;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	std::vector<std::pair<unsigned int, const Object*>> _bindings;
+	std::size_t _budget; // the number of steps left
+};
 
 // An object can represent anything. In practice, it is always an idealized
 // mathematical object, like a number or set. Objects can be cloned (deep copy),
-// and they can print themselves to output streams.
+// and they can print themselves to output streams. Each object is tagged with
+// its kind, so that sort checks and downcasts (see objectCast) are integer
+// comparisons rather than dynamic casts. A symbol can stand for a number or a
+// set, so it counts as both, but it derives directly from Object: there are no
+// virtual bases, and every object has a single vtable pointer.
 class Object {
 public:
+	// The kinds of objects. The numbers come first and the sets last, with
+	// symbols in between, so that sorts can be checked with one comparison.
+	enum Kind : std::uint8_t {
+		CONCRETE_NUMBER, COMPOUND_NUMBER, SYMBOL,
+		CONCRETE_SET, RANGE_SET, SPECIAL_SET, COMPOUND_SET
+	};
+
 	virtual ~Object();
 
+	// Returns the kind of object.
+	Kind kind() const { return _kind; }
+
+	// Returns true if the object can be used where a number (or a set) is
+	// expected. This is true of symbols in both cases.
+	bool isNumber() const { return _kind <= SYMBOL; }
+	bool isSet() const { return _kind >= SYMBOL; }
+
+	// All objects are Objects, so this is for objectCast.
+	static bool hasKind(Kind) { return true; }
+
 	// Creates a deep copy of the object. The subclasses of Object implement
 	// this by calling a cloneSelf method, which returns a more specific
 	// pointer, which is sometimes used directly to avoid dynamic casting.
 	virtual Object* clone() const = 0;
 
-	// virtual bool equal(Object* other) const = 0;
+	// Returns true if the object is structurally equal to the other one.
+	// Free symbols are equal if they have the same identifier, and bound ones
+	// if they have the same index (see Symbol), so objects that differ only in
+	// the names of bound variables are equal.
+	bool equal(const Object& other) const {
+		return this == &other || (hash() == other.hash() && equalSelf(other));
+	}
+
+	// Returns a 64-bit structural hash of the object. Equal objects have equal
+	// hashes. It is computed the first time it is needed and then cached.
+	std::uint64_t hash() const {
+		if (_hash == 0) {
+			_hash = computeHash() | 1;
+		}
+		return _hash;
+	}
 
 	// Prints a string representation of the object to the given stream.
 	virtual std::ostream& print(std::ostream& s) const = 0;
 	friend std::ostream& operator<<(std::ostream& stream, const Object& obj);
 
+	// Folds ground arithmetic within the object, in place. If the object as a
+	// whole reduces to a simpler one, returns the replacement (and the caller
+	// should delete this object); otherwise, returns null. See foldInto.
+	virtual Object* fold() = 0;
+
+	// Binds the free occurrences of the symbol identifier within the object to
+	// the quantifier depth levels up, giving them index depth. Quantified calls
+	// this on its body when it is created.
+	virtual void abstract(unsigned int id, unsigned int depth);
+
+	// Replaces the symbols bound depth levels up with clones of the term, in
+	// place, and lowers the indices of symbols bound further out, since that
+	// quantifier is gone. The term's symbols must be free, so nothing in it can
+	// be captured and nothing needs to be renamed. If the object as a whole is
+	// replaced, returns the replacement (like fold); otherwise, returns null.
+	virtual Object* substitute(unsigned int depth, const Object& term);
+
+	// Returns a copy of the object with each bound symbol replaced by a copy of
+	// its value in env (or by a free symbol if it has none), or null if it has
+	// no bound symbols. Quantifiers bind their variables to values closed this
+	// way, since the indices in a value would mean something else deeper in
+	// the body.
+	virtual Object* bindValues(const Env& env) const;
+
+	// Evaluates the object if it is a ground number (it contains no symbols
+	// other than those bound to numbers in env), storing the result in out.
+	// Returns false if it is not, which is always the case for sets.
+	// Arithmetic never overflows, since results that need it spill to large
+	// integers.
+	virtual bool evaluate(Integer& out, const Env& env) const;
+
+	// Appends the flat postfix encoding of the object to the encoder.
+	virtual void encode(Encoder& e) const = 0;
+
+	// Objects are allocated from the current arena, if there is one.
+	static void* operator new(std::size_t size) { return allocNode(size); }
+	static void operator delete(void* p) { freeNode(p); }
+
 protected:
-	Object() {}
+	explicit Object(Kind k) : _hash(0), _kind(k) {}
 	Object(const Object&) = delete;
+
+	// Compares the object to another whose hash is known to be the same.
+	virtual bool equalSelf(const Object& other) const = 0;
+
+	// Computes the structural hash of the object.
+	virtual std::uint64_t computeHash() const = 0;
+
+	mutable std::uint64_t _hash; // the cached hash, or 0
+
+private:
+	const Kind _kind; // the kind of object
 };
 
-// A number is some object that evaluates to a numerical value.
-class Number : public virtual Object {
+// Returns the object as a T if its kind is one of T's kinds, or null
+// otherwise. This takes the place of dynamic_cast for objects.
+template <typename T>
+T* objectCast(Object* obj) {
+	return obj != nullptr && T::hasKind(obj->kind())
+		? static_cast<T*>(obj) : nullptr;
+}
+template <typename T>
+const T* objectCast(const Object* obj) {
+	return obj != nullptr && T::hasKind(obj->kind())
+		? static_cast<const T*>(obj) : nullptr;
+}
+
+// A number is some object that evaluates to a numerical value. Operands that
+// must be numbers are stored as objects, since they can also be symbols.
+class Number : public Object {
 public:
 	virtual Number* cloneSelf() const = 0;
 	virtual Object* clone() const;
+	virtual Number* fold();
+
+	static bool hasKind(Kind k) {
+		return k == CONCRETE_NUMBER || k == COMPOUND_NUMBER;
+	}
+
+protected:
+	explicit Number(Kind k) : Object(k) {}
 };
 
-// A concrete number is simply an integer.
+// A concrete number is simply an integer, of any size.
 class ConcreteNumber : public Number {
 public:
-	explicit ConcreteNumber(int x);
+	explicit ConcreteNumber(Integer x);
+
+	// Returns the integer this object represents.
+	const Integer& value() const { return _x; }
+
+	static bool hasKind(Kind k) { return k == CONCRETE_NUMBER; }
+
+	virtual bool evaluate(Integer& out, const Env& env) const;
+
 	virtual Number* cloneSelf() const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
 
 private:
-	int _x; // the integer this object represents
+	Integer _x; // the integer this object represents
 };
 
 // A compound number is a sum, difference, or product of two numbers.
@@ -57,37 +256,188 @@ class CompoundNumber : public Number {
 public:
 	enum Type { ADD, SUB, MUL };
 
-	CompoundNumber(Type t, Number* a, Number* b);
+	// Creates a compound number of the operands, which must be numbers.
+	CompoundNumber(Type t, Object* a, Object* b);
 	virtual ~CompoundNumber();
 	virtual Number* cloneSelf() const;
+	virtual Number* fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual Object* substitute(unsigned int depth, const Object& term);
+	virtual Object* bindValues(const Env& env) const;
+	virtual bool evaluate(Integer& out, const Env& env) const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+	static bool hasKind(Kind k) { return k == COMPOUND_NUMBER; }
+
+	// Returns the operator printed for the type.
+	static const char* name(Type t);
 
-	// Returns the operation type specified by the string, or -1 otherwise.
-	static int getType(const std::string& s);
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
 
 private:
 	Type _type; // the operation type
-	Number* _a; // the first operand
-	Number* _b; // the second operand
+	Object* _a; // the first operand
+	Object* _b; // the second operand
 };
 
-// A set is a collection of objects. It may be finite or infinite.
-class Set : public virtual Object {
+// A set is a collection of objects. It may be finite or infinite. Like numbers,
+// operands that must be sets are stored as objects.
+class Set : public Object {
 public:
 	virtual Set* cloneSelf() const = 0;
 	virtual Object* clone() const;
+	virtual Set* fold();
+
+	static bool hasKind(Kind k) { return k > SYMBOL; }
+
+protected:
+	explicit Set(Kind k) : Object(k) {}
 };
 
-// A concrete set contains a finite list of objects.
+// A concrete set contains a finite list of objects. It is kept in a canonical
+// form: integers that fit in 64 bits are stored unboxed in a sorted array with
+// no duplicates, and other elements are kept without duplicates in the order
+// they were given, along with an index of them sorted by hash. Membership tests
+// are binary searches, and subset tests are merges. When there are many
+// integers and they all fit in 32 bits, they are stored in a compressed bitmap
+// instead of the array.
 class ConcreteSet : public Set {
 public:
+	// Creates a set of the items, taking ownership of them. Duplicate items
+	// are deleted, as are integers once their values are unboxed.
 	explicit ConcreteSet(std::vector<Object*> items);
+
 	virtual ~ConcreteSet();
+	virtual Set* cloneSelf() const;
+	virtual Set* fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual Object* substitute(unsigned int depth, const Object& term);
+	virtual Object* bindValues(const Env& env) const;
+	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+	// Returns the number of elements.
+	std::size_t size() const {
+		return _ints.size() + _bits.size() + _others.size();
+	}
+
+	// Returns true if the set contains an element equal to the given one.
+	bool contains(const Object& obj) const;
+	bool contains(long long x) const;
+
+	// Returns true if every element of this set is also in the other.
+	bool subsetOf(const ConcreteSet& other) const;
+
+	// Returns the union, intersection, or difference of this set and the
+	// other as a new set. Elements are compared structurally, so symbols are
+	// treated as distinct from everything but themselves.
+	ConcreteSet* unite(const ConcreteSet& other) const;
+	ConcreteSet* intersect(const ConcreteSet& other) const;
+	ConcreteSet* subtract(const ConcreteSet& other) const;
+
+	// Returns true if the integers are stored in a bitmap.
+	bool usesBitmap() const { return _bits.size() != 0; }
+
+	// Returns the unboxed integers, in ascending order.
+	std::vector<long long> integers() const;
+
+	// Returns the other elements, in the order they were given.
+	const NodeVec<Object*>& others() const { return _others; }
+
+	static bool hasKind(Kind k) { return k == CONCRETE_SET; }
+
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
+
+private:
+	// An index entry is the hash of an element and its position in _others.
+	typedef std::pair<std::uint64_t, std::uint32_t> Entry;
+
+	ConcreteSet() : Set(CONCRETE_SET) {}
+
+	// Adds the items to the set, taking ownership of them, and restores the
+	// canonical form.
+	void insert(std::vector<Object*>& items);
+
+	// Stores the integers in a bitmap if there are enough of them and they
+	// fit, or in the array otherwise.
+	void pack();
+
+	// Combines the integers of a and b using the bitmap operation if both sides
+	// can be bitmaps, and the given array algorithm otherwise.
+	template <typename BitOp, typename ArrayOp>
+	void combineInts(const ConcreteSet& a, const ConcreteSet& b, BitOp bitOp,
+		ArrayOp arrayOp);
+
+	// Returns the range of index entries with the given hash.
+	std::pair<const Entry*, const Entry*> lookup(std::uint64_t h) const;
+
+	NodeVec<long long> _ints; // the unboxed integers, sorted
+	Bitmap _bits; // the unboxed integers, when there are many
+	NodeVec<Object*> _others; // the other elements
+	NodeVec<Entry> _index; // the entries for _others, sorted by hash
+};
+
+// A range set is a finite union of intervals of integers, such as {1, ..., 10}
+// or {0, ...}. It is kept in a canonical form: the intervals are sorted, and no
+// two of them overlap or touch. Membership is a binary search over the
+// intervals, so it takes constant time for a single range no matter how many
+// integers it holds, and set operations sweep over the interval lists.
+class RangeSet : public Set {
+public:
+	// An interval contains the integers from its first to its second value,
+	// inclusive. The limits of long long stand for unbounded ends.
+	typedef std::pair<long long, long long> Interval;
+	static const long long MIN = std::numeric_limits<long long>::min();
+	static const long long MAX = std::numeric_limits<long long>::max();
+
+	// Creates a set of the integers in any of the intervals. Empty intervals
+	// (where the first value is greater) are ignored.
+	explicit RangeSet(std::vector<Interval> intervals);
+
+	// Creates a set of the integers from lo to hi, inclusive.
+	RangeSet(long long lo, long long hi);
+
 	virtual Set* cloneSelf() const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+	// Converts the set to a range set if its elements are all integers (or
+	// it is ZZ or null). Returns null if it can't be converted.
+	static RangeSet* fromSet(const Object& set);
+
+	// Returns true if the set contains the integer, or the object if it is a
+	// concrete number.
+	bool contains(long long x) const;
+	bool contains(const Object& obj) const;
+
+	// Returns true if the set has finitely many elements.
+	bool bounded() const;
+
+	// Returns true if every element of this set is also in the other.
+	bool subsetOf(const RangeSet& other) const;
+
+	// Returns the union, intersection, or difference of this set and the
+	// other as a new set.
+	RangeSet* unite(const RangeSet& other) const;
+	RangeSet* intersect(const RangeSet& other) const;
+	RangeSet* subtract(const RangeSet& other) const;
+
+	// Returns the intervals, in ascending order.
+	const NodeVec<Interval>& intervals() const { return _intervals; }
+
+	static bool hasKind(Kind k) { return k == RANGE_SET; }
+
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
 
 private:
-	std::vector<Object*> _items; // the elements of the set
+	NodeVec<Interval> _intervals; // the disjoint intervals, sorted
 };
 
 // A special set does not enumerate its elements. Instead, it is described by a
@@ -98,10 +448,21 @@ public:
 
 	explicit SpecialSet(Type t);
 	virtual Set* cloneSelf() const;
+
+	// Returns the type of special set.
+	Type type() const { return _type; }
+
+	static bool hasKind(Kind k) { return k == SPECIAL_SET; }
+
+	// Returns the name printed for the type.
+	static const char* name(Type t);
+
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
 
-	// Returns the set type specified by the string, or -1 otherwise.
-	static int getType(const std::string& s);
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
 
 private:
 	Type _type; // the type of special set
@@ -112,43 +473,127 @@ class CompoundSet : public Set {
 public:
 	enum Type { UNION, INTERSECT, DIFF };
 
-	CompoundSet(Type t, Set* a, Set* b);
+	// Creates a compound set of the operands, which must be sets.
+	CompoundSet(Type t, Object* a, Object* b);
 	virtual ~CompoundSet();
 	virtual Set* cloneSelf() const;
+
+	// Folds the operands, and evaluates the operation if they are both
+	// concrete sets, or if one is a range set and the other is made of
+	// integers.
+	virtual Set* fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual Object* substitute(unsigned int depth, const Object& term);
+	virtual Object* bindValues(const Env& env) const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+	// Returns the operation type and the operands.
+	Type type() const { return _type; }
+	const Object& first() const { return *_a; }
+	const Object& second() const { return *_b; }
+
+	static bool hasKind(Kind k) { return k == COMPOUND_SET; }
 
-	// Returns the operation type specified by the string, or -1 otherwise.
-	static int getType(const std::string& s);
+	// Returns the operator printed for the type.
+	static const char* name(Type t);
+
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
 
 private:
+	// Evaluates the operation if one operand is a range set and the other can
+	// be converted to one. Returns null otherwise.
+	Set* foldRanges() const;
+
 	Type _type; // the operation type
-	Set* _a; // the first operand
-	Set* _b; // the second operand
+	Object* _a; // the first operand
+	Object* _b; // the second operand
 };
 
-// A symbol is a variable which represents an object.
-class Symbol : public Number, public Set {
+// A symbol is a variable which represents an object. Bound variables use a
+// locally nameless representation: an occurrence of a quantifier's variable in
+// its body has an index giving how many quantifiers up its binder is (1 for the
+// nearest), while free symbols have index 0 and are known by their identifiers.
+// Bound symbols are compared by index, so renaming a bound variable does not
+// change the meaning of a sentence or its equality with other sentences, and
+// substitution can never capture a free symbol. Bound symbols keep the
+// identifier and name of their quantifier's variable for evaluation and
+// printing.
+class Symbol : public Object {
 public:
-	// Creates a new symbol with a unique identifier.
-	explicit Symbol(char c);
+	// Creates a new symbol with the given name and a unique identifier.
+	explicit Symbol(const char* name);
 
-	// Creates a new symbol in the given context. Fresh symbols always get
-	// unique identifiers. Non-fresh symbols (or rather, not-necessarily-fresh
-	// symbols) reuse existing identifiers if their characters are already bound
-	// in the symbol map; otherwise, they get unique identifiers as well. In all
-	// cases, if a unique identifer is generated, it will be added to the map.
-	Symbol(char c, SymMap& symbols, bool fresh);
+	// Creates a new symbol in the given context, using an interned name. Fresh
+	// symbols always get unique identifiers. Non-fresh symbols (or rather,
+	// not-necessarily-fresh symbols) reuse existing identifiers if their names
+	// are already bound in the symbol map; otherwise, they get unique
+	// identifiers as well. In all cases, if a unique identifer is generated, it
+	// will be added to the map.
+	Symbol(unsigned int name, SymMap& symbols, bool fresh);
 
 	Symbol* cloneSelf() const;
 	virtual Object* clone() const;
+	virtual Symbol* fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual Object* substitute(unsigned int depth, const Object& term);
+	virtual Object* bindValues(const Env& env) const;
+
+	// Returns a new free symbol with the same name and a unique identifier.
+	Symbol* fresh() const;
+
+	// Returns the identifier of the symbol.
+	unsigned int id() const { return _id; }
+
+	// Returns the index of the quantifier that binds the symbol, counting
+	// outward from 1, or 0 if the symbol is free.
+	unsigned int index() const { return _index; }
+
+	// Returns the object bound to the symbol in env, or null. Only quantifiers
+	// push bindings, so free symbols never have values.
+	const Object* lookup(const Env& env) const {
+		return _index == 0 ? nullptr : env.find(_id);
+	}
+
+	static bool hasKind(Kind k) { return k == SYMBOL; }
+
+	virtual bool evaluate(Integer& out, const Env& env) const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+protected:
+	virtual bool equalSelf(const Object& other) const;
+	virtual std::uint64_t computeHash() const;
 
 private:
-	// Creates a new symbol by reusing the given identifier.
-	Symbol(char c, unsigned int id);
+	// Creates a new symbol by reusing the given identifier and index.
+	Symbol(unsigned int name, unsigned int id, unsigned int index);
 
-	char _c; // the character used when printing
+	unsigned int _name; // the interned name used when printing
 	unsigned int _id; // the identifier
+	unsigned int _index; // the de Bruijn index, or 0 if free
 };
 
+// Folds the object that p points to, replacing it if it reduces to a simpler
+// one.
+inline void foldInto(Object*& p) {
+	Object* r = p->fold();
+	if (r != nullptr) {
+		delete p;
+		p = r;
+	}
+}
+
+// Substitutes the term into the object that p points to (see
+// Object::substitute), replacing it if it is the symbol being substituted.
+inline void substituteInto(Object*& p, unsigned int depth, const Object& term) {
+	Object* r = p->substitute(depth, term);
+	if (r != nullptr) {
+		delete p;
+		p = r;
+	}
+}
+
 #endif
@@ -3,247 +3,683 @@
 #include "parse.hpp"
 
 #include "object.hpp"
+#include "scan.hpp"
 #include "sentence.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
 namespace {
 	const char* err_default = "invalid input";
 	const char* err_eoi = "unexpected end of input";
 	const char* err_nan = "expected object to be a number";
-	const char* err_range = "integer out of range";
 	const char* err_nas = "expected object to be a set";
 	const char* err_comma = "expected comma in set";
-	const char* err_long = "symbols can only be one character long";
 	const char* err_char = "invalid symbol character";
+	const char* err_keyword = "keywords cannot be used as symbols";
+	const char* err_range = "expected integer bounds around '...'";
+	const char* err_depth = "expression is nested too deeply";
 }
 
 const char* parseError = nullptr;
 
+// =============================================================================
+//            Keywords
+// =============================================================================
+
+namespace {
+	// A keyword is a reserved token. Its kind says what sort of expression it
+	// begins, and the type is the corresponding enumerator of that class (for
+	// example, Relation::LT). Negated relations like >= also set positive to
+	// false. Ordinary tokens (numbers and symbols) have the kind NONE.
+	struct Keyword {
+		enum Kind {
+			NONE, NOT, LOGICAL, RELATION, QUANTIFIED,
+			COMPOUND_NUMBER, COMPOUND_SET, SPECIAL_SET
+		};
+
+		Kind _kind;
+		int _type;
+		bool _positive;
+	};
+}
+
+// Looks up a token in the keyword table. Instead of trying each keyword in
+// turn, this switches on the length and then the first character, so that at
+// most a few comparisons are needed to find the keyword (or rule it out).
+static Keyword lookupKeyword(const Token& tok) {
+	typedef Keyword K;
+	const char* s = tok._data;
+	#define IS(lit) (std::memcmp(s, lit, sizeof lit - 1) == 0)
+	switch (tok._size) {
+	case 1:
+		switch (s[0]) {
+		case '=': return {K::RELATION, Relation::EQ, true};
+		case '<': return {K::RELATION, Relation::LT, true};
+		case '>': return {K::RELATION, Relation::LTE, false};
+		case '+': return {K::COMPOUND_NUMBER, CompoundNumber::ADD, true};
+		case '-': return {K::COMPOUND_NUMBER, CompoundNumber::SUB, true};
+		case '*': return {K::COMPOUND_NUMBER, CompoundNumber::MUL, true};
+		}
+		break;
+	case 2:
+		switch (s[0]) {
+		case '!': if (IS("!=")) return {K::RELATION, Relation::EQ, false}; break;
+		case '>': if (IS(">=")) return {K::RELATION, Relation::LT, false}; break;
+		case '<': if (IS("<=")) return {K::RELATION, Relation::LTE, true}; break;
+		case '=': if (IS("=>")) return {K::LOGICAL, Logical::IMPLIES, true}; break;
+		case 's': if (IS("s=")) return {K::RELATION, Relation::SEQ, true}; break;
+		case 'i': if (IS("in")) return {K::RELATION, Relation::IN, true}; break;
+		case 'o': if (IS("or")) return {K::LOGICAL, Logical::OR, true}; break;
+		case 'Z':
+			if (IS("ZZ")) return {K::SPECIAL_SET, SpecialSet::INTEGERS, true};
+			break;
+		case 'N':
+			if (IS("NN")) return {K::SPECIAL_SET, SpecialSet::NATURALS, true};
+			break;
+		case 'S':
+			if (IS("SS")) return {K::SPECIAL_SET, SpecialSet::SETS, true};
+			break;
+		}
+		break;
+	case 3:
+		switch (s[0]) {
+		case 'a': if (IS("and")) return {K::LOGICAL, Logical::AND, true}; break;
+		case 'i': if (IS("iff")) return {K::LOGICAL, Logical::IFF, true}; break;
+		case 'n': if (IS("not")) return {K::NOT, 0, true}; break;
+		case 'd': if (IS("div")) return {K::RELATION, Relation::DIV, true}; break;
+		case 's':
+			if (IS("s!=")) return {K::RELATION, Relation::SEQ, false};
+			if (IS("sub")) return {K::RELATION, Relation::SUB, true};
+			if (IS("sup")) return {K::RELATION, Relation::SUBE, false};
+			break;
+		}
+		break;
+	case 4:
+		switch (s[0]) {
+		case 'd':
+			if (IS("diff")) return {K::COMPOUND_SET, CompoundSet::DIFF, true};
+			break;
+		case 'n':
+			if (IS("null")) return {K::SPECIAL_SET, SpecialSet::EMPTY, true};
+			break;
+		case 's':
+			if (IS("sube")) return {K::RELATION, Relation::SUBE, true};
+			if (IS("supe")) return {K::RELATION, Relation::SUB, false};
+			break;
+		}
+		break;
+	case 5:
+		switch (s[0]) {
+		case 'n': if (IS("notin")) return {K::RELATION, Relation::IN, false}; break;
+		case 'u':
+			if (IS("union")) return {K::COMPOUND_SET, CompoundSet::UNION, true};
+			break;
+		}
+		break;
+	case 6:
+		switch (s[0]) {
+		case 'e':
+			if (IS("exists")) return {K::QUANTIFIED, Quantified::EXISTS, true};
+			break;
+		case 'f':
+			if (IS("forall")) return {K::QUANTIFIED, Quantified::FORALL, true};
+			break;
+		case 'n': if (IS("notdiv")) return {K::RELATION, Relation::DIV, false}; break;
+		}
+		break;
+	case 9:
+		if (IS("intersect")) return {K::COMPOUND_SET, CompoundSet::INTERSECT, true};
+		break;
+	}
+	#undef IS
+	return {K::NONE, -1, true};
+}
+
+// =============================================================================
+//            Integer literals
+// =============================================================================
+
+// Reads an integer literal (an optional sign followed by decimal digits) and
+// stores its value in out. Returns false if the token is not an integer.
+// Symbols and keywords are rejected by the first non-digit character. Literals
+// of up to 18 digits are read directly, without allocating; longer ones are
+// handed to Integer::parse, which spills to limbs if necessary.
+static bool readInteger(const Token& tok, Integer& out) {
+	const char* p = tok._data;
+	const char* end = p + tok._size;
+	bool neg = false;
+	if (p != end && (*p == '-' || *p == '+')) {
+		neg = (*p == '-');
+		++p;
+	}
+	if (p == end) {
+		return false;
+	}
+	if (end - p > 18) {
+		return Integer::parse(tok._data, end, out);
+	}
+	long long n = 0;
+	for (; p != end; ++p) {
+		unsigned int digit = static_cast<unsigned int>(*p - '0');
+		if (digit > 9) {
+			return false;
+		}
+		n = n * 10 + digit;
+	}
+	out = Integer(neg ? -n : n);
+	return true;
+}
+
+// =============================================================================
+//            Range literals
+// =============================================================================
+
+// Returns the value of an element of a range literal, or false if it is not an
+// integer that can be a bound. The limits of long long are reserved for
+// unbounded ends.
+static bool readBound(const Object* obj, long long& out) {
+	auto n = objectCast<ConcreteNumber>(obj);
+	if (n == nullptr || !n->value().isSmall()) {
+		return false;
+	}
+	out = n->value().small();
+	return out != RangeSet::MIN && out != RangeSet::MAX;
+}
+
+// Makes a range set from the elements of a set literal, where null items stand
+// for ellipses. Each ellipsis joins the integers on either side of it into an
+// interval, or leaves that side unbounded at the start or end of the literal.
+// Deletes the items, and returns null if they don't form a valid range.
+static Object* makeRange(const std::vector<Object*>& items) {
+	std::vector<RangeSet::Interval> intervals;
+	bool ok = true;
+	std::size_t n = items.size();
+	for (std::size_t i = 0; ok && i < n;) {
+		// Only the first interval can be unbounded below.
+		long long lo = RangeSet::MIN;
+		if (items[i] == nullptr) {
+			ok = i == 0;
+		} else {
+			ok = readBound(items[i], lo);
+			++i;
+			if (i == n || items[i] != nullptr) {
+				intervals.emplace_back(lo, lo);
+				continue;
+			}
+		}
+		// Now items[i] is an ellipsis.
+		++i;
+		long long hi = RangeSet::MAX;
+		if (i < n) {
+			ok = ok && readBound(items[i], hi);
+			++i;
+		}
+		intervals.emplace_back(lo, hi);
+	}
+	for (Object* obj: items) {
+		delete obj;
+	}
+	if (!ok) {
+		return nullptr;
+	}
+	RangeSet* range = new RangeSet(intervals);
+	if (range->intervals().empty()) {
+		delete range;
+		return new ConcreteSet(std::vector<Object*>());
+	}
+	return range;
+}
+
 // =============================================================================
 //            Parse sentence
 // =============================================================================
 
-// Checks to make sure there are more tokens (as opposed to End Of Input).
-#define CHECK_EOI() do { \
-	if (i >= tokens.size()) { \
-		parseError = err_eoi; \
-		return nullptr; \
-	} \
-} while (0)
+Parser::Parser(bool fold)
+	: _lex(nullptr), _error(nullptr), _position(0), _fold(fold) {}
 
-// Checks to make sure the next token is a particular string.
-#define EXPECT(c) do { \
-	if (tokens[i++] != c) { \
-		parseError = "expected '" c "'"; \
-		return nullptr; \
-	} \
-} while (0)
+ParseResult Parser::parse(Lexer& lex) {
+	_lex = &lex;
+	_symbols.clear();
+	_error = nullptr;
+	_position = 0;
+	Index begin = lex.consumed();
+	// Complete values are attached to the frame on top of the stack. When
+	// there is no value, the top frame either asks for its next operand or is
+	// completed itself. Parsing ends when a value is left with no frames.
+	Sort sort = SENTENCE;
+	Value v = {nullptr, nullptr};
+	bool ok = start(sort, v);
+	while (ok) {
+		if (v.empty()) {
+			ok = next(sort, v);
+			if (ok && v.empty()) {
+				ok = start(sort, v);
+			}
+			if (ok && _stack.size() > parse_depth_limit) {
+				fail(err_depth);
+				ok = false;
+			}
+		} else if (_stack.empty()) {
+			_lex = nullptr;
+			return {std::move(v._sentence), nullptr, 0};
+		} else {
+			ok = attach(std::move(v));
+			v = {nullptr, nullptr};
+		}
+	}
+	unwind();
+	_lex = nullptr;
+	assert(_error != nullptr);
+	return {nullptr, _error, _position - begin};
+}
 
-// Returns a value after checking for a right parenthesis character. If it is
-// not found, deletes the created return value before returning null.
-#define RET_PAREN(x) do { \
-	auto _ret = (x); \
-	if (tokens[i++] != ")") { \
-		parseError = "expected ')'"; \
-		delete _ret; \
-		return nullptr; \
+void Parser::fail(const char* msg) {
+	if (_error == nullptr) {
+		_error = msg;
+		_position = _lex->consumed() - 1;
+	}
+}
+
+void Parser::failEOI() {
+	if (_error == nullptr) {
+		_error = err_eoi;
+		_position = _lex->consumed();
+	}
+}
+
+SentencePtr parseSentence(Lexer& lex) {
+	Parser parser;
+	ParseResult result = parser.parse(lex);
+	if (result._sentence == nullptr) {
+		parseError = result._error;
+	}
+	return std::move(result._sentence);
+}
+
+SentencePtr parseSentence(const TokVec& tokens, Index& i) {
+	Lexer lex(tokens, i);
+	SentencePtr s = parseSentence(lex);
+	i += lex.consumed();
+	return s;
+}
+
+SentencePtr parseSentence(const StrVec& tokens, Index& i) {
+	TokVec views;
+	views.reserve(tokens.size());
+	for (const std::string& tok: tokens) {
+		views.emplace_back(tok.data(), tok.size());
+	}
+	return parseSentence(views, i);
+}
+
+// Checks to make sure there are more tokens (as opposed to End Of Input).
+#define CHECK_EOI() do { \
+	if (_lex->done()) { \
+		failEOI(); \
+		return false; \
 	} \
-	return _ret; \
 } while (0)
 
-// I vow never to write a parser in C++ again. I will go running back to Parsec.
-// IC means that symbols are resolved In Context, using the SymMap.
-Sentence* parseSentenceIC(const StrVec&, Index&, SymMap&);
-Object* parseObjectIC(const StrVec&, Index&, SymMap&);
-Object* parseCompoundObjIC(const StrVec&, Index&, SymMap&);
-Number* parseNumberIC(const StrVec&, Index&, SymMap&);
-Set* parseSetIC(const StrVec&, Index&, SymMap&);
-Symbol* parseSymbolIC(const std::string&, SymMap&, bool);
-
-Sentence* parseSentence(const StrVec& tokens, Index& i) {
-	parseError = err_default;
-	SymMap symbols;
-	return parseSentenceIC(tokens, i, symbols);
+Parser::Frame& Parser::push(Frame::Kind kind, int type, bool positive) {
+	Frame f;
+	f._kind = kind;
+	f._type = type;
+	f._positive = positive;
+	f._domain = false;
+	f._count = 0;
+	f._want = SENTENCE;
+	f._var = nullptr;
+	for (int k = 0; k < 2; ++k) {
+		f._sentences[k] = nullptr;
+		f._objects[k] = nullptr;
+	}
+	f._start = _items.size();
+	_stack.push_back(std::move(f));
+	return _stack.back();
 }
 
-Sentence* parseSentenceIC(const StrVec& tokens, Index& i, SymMap& symbols) {
+bool Parser::closeParen() {
 	CHECK_EOI();
-	EXPECT("(");
-	CHECK_EOI();
-	const std::string tok = tokens[i++];
-	if (tok == "not") {
-		Sentence* p = parseSentenceIC(tokens, i, symbols);
-		if (p == nullptr) return nullptr;
-		p->negate();
-		return p;
-	}
-	int type = Logical::getType(tok);
-	if (type != -1) {
-		Sentence* a = parseSentenceIC(tokens, i, symbols);
-		if (a == nullptr) return nullptr;
-		Sentence* b = parseSentenceIC(tokens, i, symbols);
-		if (b == nullptr) { delete a; return nullptr; }
-		RET_PAREN(new Logical(static_cast<Logical::Type>(type), a, b));
-	}
-	auto rtype = Relation::getType(tok);
-	if (rtype.first != -1) {
-		Object* a = parseObjectIC(tokens, i, symbols);
-		if (a == nullptr) return nullptr;
-		Object* b = parseObjectIC(tokens, i, symbols);
-		if (b == nullptr) { delete a; return nullptr; }
-		RET_PAREN(new Relation(static_cast<Relation::Type>(rtype.first), rtype.second, a, b));
-	}
-	type = Quantified::getType(tok);
-	if (type != -1) {
-		CHECK_EOI();
-		const std::string tok2 = tokens[i++];
-		Symbol* var = parseSymbolIC(tok2, symbols, true);
-		CHECK_EOI();
-		const std::string tok3 = tokens[i++];
-		auto qt = static_cast<Quantified::Type>(type);
-		if (tok3 == "in") {
-			Set* set = parseSetIC(tokens, i, symbols);
-			if (set == nullptr) { delete var; return nullptr; }
-			Sentence* body = parseSentenceIC(tokens, i, symbols);
-			if (body == nullptr) { delete var; delete set; return nullptr; }
-			RET_PAREN(new Quantified(qt, var, set, body));
-		} else {
-			i--;
-			Sentence* body = parseSentenceIC(tokens, i, symbols);
-			if (body == nullptr) { delete var; return nullptr; }
-			RET_PAREN(new Quantified(qt, var, body));
+	if (_lex->next() != ")") {
+		fail("expected ')'");
+		return false;
+	}
+	return true;
+}
+
+void Parser::unwind() {
+	for (Frame& f: _stack) {
+		delete f._var;
+		for (int k = 0; k < 2; ++k) {
+			delete f._objects[k];
 		}
 	}
-	return nullptr;
+	for (Object* obj: _items) {
+		delete obj;
+	}
+	_stack.clear();
+	_items.clear();
 }
 
 // =============================================================================
-//            Parse object
+//            Parse expression
 // =============================================================================
 
-Object* parseObjectIC(const StrVec& tokens, Index& i, SymMap& symbols) {
+bool Parser::start(Sort sort, Value& v) {
 	CHECK_EOI();
-	const std::string tok = tokens[i++];
+	if (sort == SENTENCE) {
+		if (_lex->next() != "(") {
+			fail("expected '('");
+			return false;
+		}
+		CHECK_EOI();
+		const Keyword kw = lookupKeyword(_lex->next());
+		switch (kw._kind) {
+		case Keyword::NOT:
+			push(Frame::NOT, 0, true);
+			return true;
+		case Keyword::LOGICAL:
+			push(Frame::LOGICAL, kw._type, true);
+			return true;
+		case Keyword::RELATION:
+			push(Frame::RELATION, kw._type, kw._positive);
+			return true;
+		case Keyword::QUANTIFIED: {
+			CHECK_EOI();
+			Symbol* var = parseSymbol(_lex->next(), true);
+			if (var == nullptr) {
+				return false;
+			}
+			Frame& f = push(Frame::QUANTIFIED, kw._type, true);
+			f._var = var;
+			CHECK_EOI();
+			if (_lex->peek() == "in") {
+				_lex->next();
+				f._domain = true;
+			}
+			return true;
+		}
+		default:
+			fail(err_default);
+			return false;
+		}
+	}
+
+	const Token tok = _lex->next();
 	if (tok == "(") {
-		RET_PAREN(parseCompoundObjIC(tokens, i, symbols));
+		CHECK_EOI();
+		const Keyword kw = lookupKeyword(_lex->next());
+		switch (kw._kind) {
+		case Keyword::COMPOUND_NUMBER:
+			push(Frame::COMPOUND_NUMBER, kw._type, true);
+			return true;
+		case Keyword::COMPOUND_SET:
+			push(Frame::COMPOUND_SET, kw._type, true);
+			return true;
+		default:
+			fail(err_default);
+			return false;
+		}
 	}
 	if (tok == "{") {
-		std::vector<Object*> items;
-		bool success = true;
-		for (;;) {
-			if (i >= tokens.size()) {
-				parseError = err_eoi;
-				success = false;
-				break;
-			}
-			const std::string tok2 = tokens[i++];
-			if (tok2 == "}") {
-				break;
-			}
-			i--;
-			Object* obj = parseObjectIC(tokens, i, symbols);
-			if (obj == nullptr) {
-				success = false;
-				break;
+		CHECK_EOI();
+		if (_lex->peek() == "}") {
+			_lex->next();
+			v._object = new ConcreteSet(std::vector<Object*>());
+		} else {
+			push(Frame::SET_LITERAL, 0, true);
+		}
+		return true;
+	}
+	const Keyword kw = lookupKeyword(tok);
+	if (kw._kind == Keyword::SPECIAL_SET) {
+		v._object = new SpecialSet(static_cast<SpecialSet::Type>(kw._type));
+		return true;
+	}
+	Integer num;
+	if (readInteger(tok, num)) {
+		v._object = new ConcreteNumber(std::move(num));
+		return true;
+	}
+	v._object = parseSymbol(tok, false);
+	return v._object != nullptr;
+}
+
+bool Parser::attach(Value&& v) {
+	Frame& f = _stack.back();
+	int k = f._count++;
+	switch (f._want) {
+	case SENTENCE:
+		f._sentences[k] = std::move(v._sentence);
+		break;
+	case OBJECT:
+		if (f._kind == Frame::SET_LITERAL) {
+			_items.push_back(v._object);
+		} else {
+			f._objects[k] = v._object;
+		}
+		break;
+	case NUMBER:
+	case SET:
+		if (f._want == NUMBER ? !v._object->isNumber() : !v._object->isSet()) {
+			delete v._object;
+			fail(f._want == NUMBER ? err_nan : err_nas);
+			return false;
+		}
+		f._objects[k] = v._object;
+		break;
+	}
+	return true;
+}
+
+bool Parser::next(Sort& sort, Value& v) {
+	Frame& f = _stack.back();
+	switch (f._kind) {
+	case Frame::NOT:
+		if (f._count < 1) {
+			sort = f._want = SENTENCE;
+			return true;
+		}
+		if (!closeParen()) return false;
+		v._sentence = std::move(f._sentences[0]);
+		v._sentence->negate();
+		break;
+	case Frame::LOGICAL:
+		if (f._count < 2) {
+			sort = f._want = SENTENCE;
+			return true;
+		}
+		if (!closeParen()) return false;
+		v._sentence.reset(new Logical(static_cast<Logical::Type>(f._type),
+			f._sentences[0].release(), f._sentences[1].release()));
+		break;
+	case Frame::RELATION:
+		if (f._count < 2) {
+			sort = f._want = OBJECT;
+			return true;
+		}
+		if (!closeParen()) return false;
+		v._sentence.reset(new Relation(static_cast<Relation::Type>(f._type),
+			f._positive, f._objects[0], f._objects[1]));
+		break;
+	case Frame::QUANTIFIED: {
+		int operands = f._domain ? 2 : 1;
+		if (f._count < operands) {
+			sort = f._want = (f._count == 0 && f._domain) ? SET : SENTENCE;
+			return true;
+		}
+		if (!closeParen()) return false;
+		auto qt = static_cast<Quantified::Type>(f._type);
+		if (f._domain) {
+			v._sentence.reset(new Quantified(qt, f._var, f._objects[0],
+				f._sentences[1].release()));
+		} else {
+			v._sentence.reset(new Quantified(qt, f._var,
+				f._sentences[0].release()));
+		}
+		break;
+	}
+	case Frame::COMPOUND_NUMBER:
+		if (f._count < 2) {
+			sort = f._want = NUMBER;
+			return true;
+		}
+		if (!closeParen()) return false;
+		{
+			Object* n = new CompoundNumber(
+				static_cast<CompoundNumber::Type>(f._type),
+				f._objects[0], f._objects[1]);
+			// The operands were folded already, so this is constant time.
+			if (_fold) {
+				foldInto(n);
 			}
-			items.push_back(obj);
-			if (i >= tokens.size()) {
-				parseError = err_eoi;
-				success = false;
-				break;
+			v._object = n;
+		}
+		break;
+	case Frame::COMPOUND_SET:
+		if (f._count < 2) {
+			sort = f._want = SET;
+			return true;
+		}
+		if (!closeParen()) return false;
+		{
+			Object* set = new CompoundSet(
+				static_cast<CompoundSet::Type>(f._type),
+				f._objects[0], f._objects[1]);
+			if (_fold) {
+				foldInto(set);
 			}
-			const std::string tok3 = tokens[i++];
-			if (tok3 == "}") {
-				break;
+			v._object = set;
+		}
+		break;
+	case Frame::SET_LITERAL: {
+		// After each element comes a comma or the closing brace. A comma may
+		// also be followed by the closing brace. An ellipsis can stand in for
+		// an element, and is recorded as a null item.
+		for (bool first = f._count == 0;; first = false) {
+			if (!first) {
+				CHECK_EOI();
+				const Token tok = _lex->next();
+				if (tok == "}") {
+					break;
+				}
+				if (tok != ",") {
+					fail(err_comma);
+					return false;
+				}
+				CHECK_EOI();
+				if (_lex->peek() == "}") {
+					_lex->next();
+					break;
+				}
 			}
-			if (tok3 != ",") {
-				parseError = err_comma;
-				success = false;
-				break;
+			CHECK_EOI();
+			if (_lex->peek() != "...") {
+				sort = f._want = OBJECT;
+				return true;
 			}
+			_lex->next();
+			_items.push_back(nullptr);
+			++f._count;
 		}
-		if (success) {
-			return new ConcreteSet(items);
-		}
-		for (Object* obj: items) {
-			delete obj;
+		auto first = _items.begin() + static_cast<std::ptrdiff_t>(f._start);
+		std::vector<Object*> items(first, _items.end());
+		_items.erase(first, _items.end());
+		if (std::find(items.begin(), items.end(), nullptr) == items.end()) {
+			v._object = new ConcreteSet(items);
+		} else {
+			v._object = makeRange(items);
+			if (v._object == nullptr) {
+				fail(err_range);
+				return false;
+			}
 		}
-		return nullptr;
+		break;
 	}
-	int type = SpecialSet::getType(tok);
-	if (type != -1) {
-		return new SpecialSet(static_cast<SpecialSet::Type>(type));
-	}
-	try {
-		int num = std::stoi(tok);
-		return new ConcreteNumber(num);
-	} catch (const std::invalid_argument& e) {
-		(void)e;
-	} catch (const std::out_of_range& e) {
-		(void)e;
-		parseError = err_range;
-		return nullptr;
 	}
-	return parseSymbolIC(tok, symbols, false);
+	_stack.pop_back();
+	return true;
 }
 
-Object* parseCompoundObjIC(const StrVec& tokens, Index& i, SymMap& symbols) {
-	CHECK_EOI();
-	const std::string tok = tokens[i++];
-	int type = CompoundNumber::getType(tok);
-	if (type != -1) {
-		Number* a = parseNumberIC(tokens, i, symbols);
-		if (a == nullptr) return nullptr;
-		Number* b = parseNumberIC(tokens, i, symbols);
-		if (b == nullptr) { delete a; return nullptr; }
-		auto t = static_cast<CompoundNumber::Type>(type);
-		return new CompoundNumber(t, a, b);
-	}
-	type = CompoundSet::getType(tok);
-	if (type != -1) {
-		Set* a = parseSetIC(tokens, i, symbols);
-		if (a == nullptr) return nullptr;
-		Set* b = parseSetIC(tokens, i, symbols);
-		if (b == nullptr) { delete a; return nullptr; }
-		return new CompoundSet(static_cast<CompoundSet::Type>(type), a, b);
-	}
-	return nullptr;
+// Returns true if the character can begin a symbol.
+static bool isSymbolStart(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
-Number* parseNumberIC(const StrVec& tokens, Index& i, SymMap& symbols) {
-	Object* obj = parseObjectIC(tokens, i, symbols);
-	if (obj == nullptr) return nullptr;
-	Number* num = dynamic_cast<Number*>(obj);
-	if (num == nullptr) {
-		delete obj;
-		parseError = err_nan;
+// Returns true if the character can appear after the start of a symbol.
+static bool isSymbolChar(char c) {
+	return isSymbolStart(c) || (c >= '0' && c <= '9') || c == '_' || c == '\'';
+}
+
+Symbol* Parser::parseSymbol(const Token& tok, bool fresh) {
+	if (!isSymbolStart(tok._data[0])) {
+		fail(err_char);
+		return nullptr;
+	}
+	for (std::size_t k = 1; k < tok._size; ++k) {
+		if (!isSymbolChar(tok._data[k])) {
+			fail(err_char);
+			return nullptr;
+		}
+	}
+	if (lookupKeyword(tok)._kind != Keyword::NONE) {
+		fail(err_keyword);
 		return nullptr;
 	}
-	return num;
+	return new Symbol(internName(tok._data, tok._size), _symbols, fresh);
 }
 
-Set* parseSetIC(const StrVec& tokens, Index& i, SymMap& symbols) {
-	Object* obj = parseObjectIC(tokens, i, symbols);
-	if (obj == nullptr) return nullptr;
-	Set* set = dynamic_cast<Set*>(obj);
-	if (set == nullptr) {
-		delete obj;
-		parseError = err_nas;
-		return nullptr;
+// =============================================================================
+//            Lexer
+// =============================================================================
+
+Lexer::Lexer(const char* str) : Lexer(str, str + std::strlen(str)) {}
+
+Lexer::Lexer(const char* begin, const char* end)
+	: _pos(begin), _end(end), _tok(nullptr), _tokEnd(nullptr), _count(0) {}
+
+Lexer::Lexer(const TokVec& tokens, Index i)
+	: _pos(nullptr), _end(nullptr),
+	_tok(tokens.data() + std::min(i, tokens.size())),
+	_tokEnd(tokens.data() + tokens.size()), _count(0) {}
+
+bool Lexer::done() {
+	if (_tok != nullptr) {
+		return _tok == _tokEnd;
+	}
+	while (_pos != _end && isSpace(*_pos)) {
+		++_pos;
 	}
-	return set;
+	return _pos == _end;
 }
 
-Symbol* parseSymbolIC(const std::string& str, SymMap& symbols, bool fresh) {
-	if (str.length() > 1) {
-		parseError = err_long;
-		return nullptr;
+Token Lexer::peek() {
+	assert(!done());
+	if (_tok != nullptr) {
+		return *_tok;
 	}
-	char c = str[0];
-	if (!(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z')) {
-		parseError = err_char;
-		return nullptr;
+	if (isPunct(*_pos)) {
+		return Token(_pos, 1);
+	}
+	const char* p = _pos;
+	while (p != _end && !isPunct(*p) && !isSpace(*p)) {
+		++p;
 	}
-	return new Symbol(c, symbols, fresh);
+	return Token(_pos, static_cast<std::size_t>(p - _pos));
+}
+
+Token Lexer::next() {
+	Token tok = peek();
+	if (_tok != nullptr) {
+		++_tok;
+	} else {
+		_pos = tok._data + tok._size;
+	}
+	++_count;
+	return tok;
 }
 
 // =============================================================================
@@ -252,24 +688,15 @@ Symbol* parseSymbolIC(const std::string& str, SymMap& symbols, bool fresh) {
 
 StrVec tokenize(char* line) {
 	StrVec tokens;
-	char c;
-	std::string s;
-	while ((c = *line++)) {
-		bool punct = (c == '(' || c == ')' || c == '{' || c == '}' || c == ',');
-		if (punct || c == ' ' || c == '\t' || c == '\n' || c == '\r') {
-			if (!s.empty()) {
-				tokens.push_back(s);
-				s.clear();
-			}
-			if (punct) {
-				tokens.push_back(std::string(1, c));
-			}
-		} else {
-			s.push_back(c);
-		}
-	}
-	if (!s.empty()) {
-		tokens.push_back(s);
+	Lexer lex(line);
+	while (!lex.done()) {
+		tokens.push_back(lex.next().str());
 	}
 	return tokens;
 }
+
+TokVec tokenizeView(const char* line) {
+	TokVec tokens;
+	scanTokens(bestScanImpl(), line, line + std::strlen(line), tokens);
+	return tokens;
+}
@@ -3,24 +3,184 @@
 #ifndef PARSE_H
 #define PARSE_H
 
+#include "object.hpp"
 #include "sentence.hpp"
+#include "token.hpp"
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
 typedef std::vector<std::string> StrVec;
-typedef StrVec::size_type Index;
+typedef std::vector<Token> TokVec;
+typedef TokVec::size_type Index;
 
-// The parsing functions always store an error message in this string when they
-// fail, before returning null.
+// The parseSentence functions always store an error message in this string
+// when they fail, before returning null. Since it is shared, those functions
+// must not be used on more than one thread at a time; use a Parser instead.
 extern const char* parseError;
 
-// Parses a complete sentence in prefix notation. Returns null on failure and
-// stores an error message in parseError.
-Sentence* parseSentence(const StrVec& tokens, Index& i);
+// A lexer is a cursor over a character buffer that produces tokens on demand,
+// so that the parser can consume input without tokenizing all of it first. It
+// splits tokens the same way as tokenize. It can also replay a vector of tokens
+// that was produced ahead of time.
+class Lexer {
+public:
+	// Creates a lexer over a null-terminated string.
+	explicit Lexer(const char* str);
+
+	// Creates a lexer over the characters in [begin, end).
+	Lexer(const char* begin, const char* end);
+
+	// Creates a lexer that replays the tokens starting at index i.
+	Lexer(const TokVec& tokens, Index i);
+
+	// Returns true if there are no more tokens.
+	bool done();
+
+	// Assumes there are more tokens. Returns the next token without consuming
+	// it, or consumes it and returns it.
+	Token peek();
+	Token next();
+
+	// Returns the number of tokens consumed so far.
+	Index consumed() const { return _count; }
+
+private:
+	const char* _pos; // the current position in the buffer
+	const char* _end; // the end of the buffer
+	const Token* _tok; // the next token when replaying, or null
+	const Token* _tokEnd; // the end of the replayed tokens
+	Index _count; // the number of tokens consumed
+};
+
+// The result of parsing a sentence. On success, the sentence is non-null, and
+// it can be moved out to take ownership of it. On failure, it is null, error
+// describes the problem, and position is the index of the offending token
+// (counting from where the parse began).
+class ParseResult {
+public:
+	SentencePtr _sentence; // the parsed sentence, or null
+	const char* _error; // the error message, or null
+	Index _position; // the token index of the error
+};
+
+// The deepest nesting of expressions that a parser accepts. Parsing does not
+// recurse, but printing, copying, hashing, evaluating and deleting sentences
+// all do, once per level. This keeps every parsed sentence shallow enough for
+// them to stay well within the call stack (even on threads).
+const std::size_t parse_depth_limit = 10000;
+
+// A parser turns tokens into a sentence. All the state it needs while parsing
+// lives in the parser itself, so different threads can parse at the same time
+// as long as each one uses its own parser. A parser can be reused for any
+// number of sentences, one after another. It does not recurse, and instead
+// keeps a stack of pending expressions on the heap. That stack is kept between
+// parses, so reusing a parser avoids reallocating it. Input nested more deeply
+// than parse_depth_limit is rejected with an error.
+class Parser {
+public:
+	// Creates a parser. If fold is true, ground arithmetic is folded as it is
+	// parsed, so that (+ 1 1) produces the same tree as 2.
+	explicit Parser(bool fold = false);
+
+	// Parses a complete sentence in prefix notation, pulling tokens from the
+	// lexer only as they are needed. On failure, the lexer is left somewhere
+	// after the offending token.
+	ParseResult parse(Lexer& lex);
+
+private:
+	// The sort of expression expected next. Numbers and sets are objects that
+	// are checked to be of the right sort once they are complete.
+	enum Sort { SENTENCE, OBJECT, NUMBER, SET };
+
+	// A value is a complete expression: either a sentence or an object.
+	class Value {
+	public:
+		bool empty() const { return _sentence == nullptr && _object == nullptr; }
+
+		SentencePtr _sentence;
+		Object* _object;
+	};
+
+	// A frame is a compound expression waiting for its operands. The operand
+	// arrays are used according to the kind of frame (for example, RELATION
+	// uses the objects and LOGICAL uses the sentences). Numbers and sets are
+	// stored as objects once their sorts are checked. Set literals keep
+	// their elements on a separate shared stack, starting at index start.
+	class Frame {
+	public:
+		enum Kind {
+			NOT, LOGICAL, RELATION, QUANTIFIED,
+			COMPOUND_NUMBER, COMPOUND_SET, SET_LITERAL
+		};
+
+		Kind _kind; // the kind of expression
+		int _type; // the type enumerator for that kind
+		bool _positive; // false for negated relations
+		bool _domain; // true for quantifiers using the domain shorthand
+		int _count; // the number of operands received so far
+		Sort _want; // the sort of the operand being parsed
+		Symbol* _var; // the bound variable of a quantifier
+		SentencePtr _sentences[2];
+		Object* _objects[2];
+		std::vector<Object*>::size_type _start;
+	};
+
+	// Begins parsing an expression of the given sort. If it is an atom, stores
+	// it in the value. Otherwise, pushes a frame for it. Returns false on error.
+	bool start(Sort sort, Value& v);
+
+	// Checks that the value is of the sort wanted by the frame on top of the
+	// stack, and adds it as the frame's next operand. Returns false on error.
+	bool attach(Value&& v);
+
+	// Looks at the frame on top of the stack. If it needs more operands, sets
+	// the sort it wants next (in the frame and in sort). Otherwise, pops the
+	// frame and stores the completed expression in the value. Returns false on
+	// error.
+	bool next(Sort& sort, Value& v);
+
+	// Pushes a new frame with no operands, and returns it.
+	Frame& push(Frame::Kind kind, int type, bool positive);
+
+	// Consumes the closing parenthesis of a compound expression.
+	bool closeParen();
+
+	// Deletes the operands of every frame, leaving the stack empty.
+	void unwind();
+
+	// Parses a symbol from the token, resolving it in context (the SymMap).
+	Symbol* parseSymbol(const Token& tok, bool fresh);
+
+	// Records an error about the token that was just consumed, or an error
+	// about reaching the end of input.
+	void fail(const char* msg);
+	void failEOI();
+
+	Lexer* _lex; // the lexer for the current parse
+	SymMap _symbols; // the symbols in scope
+	std::vector<Frame> _stack; // the expressions being parsed
+	std::vector<Object*> _items; // the elements of set literals being parsed
+	const char* _error; // the first error encountered, or null
+	Index _position; // the token index of the error
+	bool _fold; // whether to fold ground arithmetic
+};
+
+// Convenience wrappers around Parser that return null on failure and store an
+// error message in parseError. The vector versions parse tokens starting at
+// index i, and advance i past the tokens that were consumed.
+SentencePtr parseSentence(Lexer& lex);
+SentencePtr parseSentence(const TokVec& tokens, Index& i);
+SentencePtr parseSentence(const StrVec& tokens, Index& i);
 
 // Returns a vector of string tokens by splitting on whitespace. Left and right
 // parentheses/braces and commas are always treated as separate tokens.
 StrVec tokenize(char* line);
 
+// Splits the line the same way as tokenize, but returns views into the line
+// instead of copying each token into its own string. This classifies many
+// characters at once using SIMD instructions when the processor has them.
+TokVec tokenizeView(const char* line);
+
 #endif
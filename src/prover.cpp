@@ -10,6 +10,8 @@
 #include <queue>
 #include <sstream>
 #include <string>
+#include <unordered_set>
+#include <utility>
 
 #include <cassert>
 
@@ -48,11 +50,12 @@ static void printUnderlined(const char* str) {
 class TheoremProver::Node {
 public:
 	// Creates a new node with the supplied goal, and optionally starting with
-	// one given (otherwise it will have no givens).
-	Node(Sentence* goal, Sentence* given = nullptr);
+	// one given (otherwise it will have no givens). The sentences must have
+	// been allocated in the theorem prover's arena, which takes them over.
+	explicit Node(SentencePtr goal, SentencePtr given = nullptr);
 
-	// Deletes this node and all nodes below it. Also deletes the goal and all
-	// the givens of the node.
+	// Deletes this node and all nodes below it. The goal and the givens are
+	// not deleted, since they live in the theorem prover's arena.
 	~Node();
 
 	// Accessors for the goal, givens, and children of the node.
@@ -61,12 +64,12 @@ public:
 	Node* primaryChild() const { return _a; }
 	Node* secondaryChild() const { return _b; }
 
-	// Assumes this is a leaf node. Adds one or two children to the node via a
-	// decomp object.
-	void decompose(Decomp d);
+	// Assumes this is a leaf node. Adds one or two children to the node by
+	// building the sentences of the decomp.
+	void decompose(const Decomp& d);
 
-	// Adds a given to the node.
-	void deduce(Sentence* g);
+	// Adds a given to the node, which the arena takes over.
+	void deduce(SentencePtr g);
 
 	// Returns true if this node has any givens.
 	bool hasGivens() const;
@@ -100,36 +103,34 @@ namespace {
 	char genUniqueLabel() { return currentLabel++; }
 }
 
-TheoremProver::Node::Node(Sentence* goal, Sentence* given)
-		: _goal(goal), _a(nullptr), _b(nullptr),
+TheoremProver::Node::Node(SentencePtr goal, SentencePtr given)
+		: _goal(goal.release()), _a(nullptr), _b(nullptr),
 		_label(genUniqueLabel()) {
-	assert(goal != nullptr);
+	assert(_goal != nullptr);
 	if (given != nullptr) {
-		deduce(given);
+		deduce(std::move(given));
 	}
 }
 
 TheoremProver::Node::~Node() {
-	for (Sentence* g: _givens) {
-		delete g;
-	}
-	delete _goal;
 	delete _a;
 	delete _b;
 }
 
-void TheoremProver::Node::decompose(Decomp d) {
+void TheoremProver::Node::decompose(const Decomp& d) {
 	assert(_a == nullptr);
 	assert(_b == nullptr);
-	_a = new Node(d._goalA, d._givenA);
-	if (d._goalB != nullptr) {
-		_b = new Node(d._goalB, d._givenB);
+	SentencePtr givenA, goalA, givenB, goalB;
+	d.build(givenA, goalA, givenB, goalB);
+	_a = new Node(std::move(goalA), std::move(givenA));
+	if (goalB != nullptr) {
+		_b = new Node(std::move(goalB), std::move(givenB));
 	}
 }
 
-void TheoremProver::Node::deduce(Sentence* g) {
+void TheoremProver::Node::deduce(SentencePtr g) {
 	assert(g != nullptr);
-	_givens.push_back(g);
+	_givens.push_back(g.release());
 }
 
 bool TheoremProver::Node::hasGivens() const {
@@ -326,16 +327,23 @@ void TheoremProver::cleanUp() {
 	_lineage.clear();
 }
 
-void TheoremProver::setTheorem(Sentence* s) {
+void TheoremProver::setTheorem(const Sentence* s) {
 	delete _root;
 	cleanUp();
+	_arena.release();
 	if (s == nullptr) {
 		_root = nullptr;
 	} else {
-		_root = new Node(s);
+		SentencePtr thm;
+		{
+			ArenaScope scope(_arena);
+			thm.reset(s->clone());
+		}
+		_root = new Node(std::move(thm));
 		_dfs.push_back(_root);
 		_lineage.push_back(_root);
 		printGoal();
+		checkGoal();
 	}
 }
 
@@ -347,6 +355,7 @@ TheoremProver::Mode TheoremProver::mode() const {
 
 void TheoremProver::decompose() {
 	assert(mode() == PROVING);
+	ArenaScope scope(_arena);
 	std::vector<Decomp> vec = currentNode()->goal()->decompose();
 
 	if (vec.empty()) {
@@ -364,17 +373,8 @@ void TheoremProver::decompose() {
 		std::cout << '\n';
 	}
 
-	// FIXME: The following is pretty wasteful. It is only necessary to do it
-	// this way for deduction, since each hypothesis needs to be checked and
-	// each conclusion needs to be displayed.
-
-	// Get the index, and delete the unused decomps.
+	// Only the chosen option's sentences get built.
 	int option = readIndex(0, static_cast<int>(vec.size()));
-	for (int j = 0; j < static_cast<int>(vec.size()); j++) {
-		if (j != option - 1) {
-			vec[static_cast<size_t>(j)].free();
-		}
-	}
 	if (option == 0) {
 		std::cout << "Decomposition aborted.\n";
 		return;
@@ -391,33 +391,48 @@ void TheoremProver::decompose() {
 	_lineage.push_back(n->primaryChild());
 	std::cout << "New goal: ";
 	printGoal();
+	checkGoal();
 }
 
 void TheoremProver::deduce() {
 	assert(mode() == PROVING);
-	std::vector<Deduct> vec;
+	ArenaScope scope(_arena);
+	// Index the givens by structure, so that deductions which would repeat a
+	// given (or each other) can be left out.
+	std::unordered_set<const Sentence*, SentenceHash, SentenceEqual> known;
 	for (const Node* n: _lineage) {
 		for (const Sentence* s: n->givens()) {
-			std::vector<Deduct> ds = s->deduce();
-			vec.insert(vec.end(), ds.begin(), ds.end());
+			known.insert(s);
+		}
+	}
+	// The conclusions are needed to display the options and leave out
+	// repeats, but the hypotheses are not built yet.
+	// Conclusions that are left out, or not chosen, are deleted along with
+	// the vector.
+	std::vector<std::pair<Deduct, SentencePtr>> vec;
+	for (const Node* n: _lineage) {
+		for (const Sentence* s: n->givens()) {
+			for (Deduct& d: s->deduce()) {
+				SentencePtr conc = d.conclusion();
+				if (known.insert(conc.get()).second) {
+					vec.emplace_back(std::move(d), std::move(conc));
+				}
+			}
 		}
 	}
 
 	if (vec.empty()) {
-		std::cout << "No deductions can be made.\n";
+		std::cout << "No new deductions can be made.\n";
 		return;
 	}
 
 	// TODO: Filter out failed hypotheses.
-	// TODO: Avoid duplicate givens.
 
 	std::cout << "Choose a sentence to deduce.\n";
 	std::cout << "(0) abort\n";
 	int i = 1;
-	for (const Deduct& d: vec) {
-		std::cout << '(' << i++ << ") ";
-		d.print();
-		std::cout << '\n';
+	for (const auto& d: vec) {
+		std::cout << '(' << i++ << ") " << *d.second << '\n';
 	}
 	std::cout << '(' << i << ") all of the above\n";
 
@@ -425,27 +440,21 @@ void TheoremProver::deduce() {
 	int option = readIndex(0, sz + 1);
 	if (option == sz + 1) {
 		Node* n = currentNode();
-		for (const Deduct& d: vec) {
-			delete d._hyp;
-			n->deduce(d._conc);
+		for (auto& d: vec) {
+			n->deduce(std::move(d.second));
 		}
 		std::cout << "Deduced " << sz << " sentence(s).\n";
+		checkGoal();
 		return;
 	}
-	for (int j = 0; j < static_cast<int>(vec.size()); j++) {
-		if (j != option - 1) {
-			vec[static_cast<size_t>(j)].free();
-		}
-	}
 	if (option == 0) {
-		std::cout << "Decomposition aborted.\n";
+		std::cout << "Deduction aborted.\n";
 		return;
 	}
 	Node* n = currentNode();
-	Deduct chosen = vec[static_cast<size_t>(option - 1)];
-	delete chosen._hyp;
-	n->deduce(chosen._conc);
+	n->deduce(std::move(vec[static_cast<size_t>(option - 1)].second));
 	std::cout << "Deduction successful.\n";
+	checkGoal();
 }
 
 void TheoremProver::trivial() {
@@ -458,6 +467,7 @@ void TheoremProver::trivial() {
 		updateLineage();
 		std::cout << "Goal proved.\nNew goal: ";
 		printGoal();
+		checkGoal();
 	}
 }
 
@@ -531,6 +541,42 @@ TheoremProver::Node* TheoremProver::currentNode() const {
 	return _dfs.back();
 }
 
+bool TheoremProver::goalIsGiven() const {
+	const Sentence* goal = currentNode()->goal();
+	for (const Node* n: _lineage) {
+		for (const Sentence* s: n->givens()) {
+			if (s->equal(*goal)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TheoremProver::hintIfGiven() const {
+	if (goalIsGiven()) {
+		std::cout << "The goal is already a given. Use \"triv\" to prove it.\n";
+	}
+}
+
+void TheoremProver::checkGoal() {
+	switch (currentNode()->goal()->value()) {
+	case Sentence::TRUE:
+		std::cout << "The goal is true by evaluation.\n";
+		trivial();
+		return;
+	case Sentence::FALSE:
+		startRed(std::cout);
+		std::cout << "Warning: the goal is false by evaluation.";
+		stopRed(std::cout);
+		std::cout << '\n';
+		break;
+	case Sentence::MU:
+		break;
+	}
+	hintIfGiven();
+}
+
 void TheoremProver::updateLineage() {
 	Node* c = currentNode();
 	while (!_lineage.empty()
@@ -3,6 +3,8 @@
 #ifndef PROVER_H
 #define PROVER_H
 
+#include "arena.hpp"
+
 #include <vector>
 
 class Sentence;
@@ -17,9 +19,11 @@ public:
 
 	~TheoremProver();
 
-	// Changes the theorem to be proved. Deletes the old theorem. Passing null
-	// has the effect of clearing the theorem.
-	void setTheorem(Sentence* s);
+	// Changes the theorem to be proved to a copy of s. The old proof is
+	// released all at once along with the arena holding its sentences, and the
+	// new theorem is copied into the arena (s still belongs to the caller).
+	// Passing null has the effect of clearing the theorem.
+	void setTheorem(const Sentence* s);
 
 	// Returns the current mode of the theorem prover. It begins at NOTHM,
 	// becomes PROVING once a theorem is loaded, and switches to DONE once the
@@ -63,10 +67,22 @@ private:
 	// most recent change to current node.
 	void updateLineage();
 
+	// Returns true if the current goal is equal to one of the givens.
+	bool goalIsGiven() const;
+
+	// Prints a hint to use "triv" if the current goal is already a given.
+	void hintIfGiven() const;
+
+	// Evaluates the current goal. If it is true, proves it automatically (and
+	// moves on to the next goal). Otherwise, warns if it is false and gives
+	// the hint above.
+	void checkGoal();
+
 	// Cleans up some resources. Intended to be called when the theorem prover
 	// transitions into the DONE mode.
 	void cleanUp();
 
+	Arena _arena; // holds all the sentences in the proof
 	Node* _root; // the root of the given/goal tree
 	std::vector<Node*> _dfs; // the stack used for depth-first traversal
 	std::vector<Node*> _lineage; // goes from root to the current node
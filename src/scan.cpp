@@ -0,0 +1,200 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+namespace {
+	const std::size_t block_size = 64;
+}
+
+// Returns the index of the lowest set bit. Assumes x is nonzero.
+static unsigned int lowestBit(std::uint64_t x) {
+#ifdef __GNUC__
+	return static_cast<unsigned int>(__builtin_ctzll(x));
+#else
+	unsigned int k = 0;
+	while ((x & 1) == 0) {
+		x >>= 1;
+		++k;
+	}
+	return k;
+#endif
+}
+
+// =============================================================================
+//            Classification
+// =============================================================================
+
+static void classifyScalar(const char* p, CharMasks& masks) {
+	std::uint64_t punct = 0;
+	std::uint64_t space = 0;
+	for (unsigned int k = 0; k < block_size; ++k) {
+		std::uint64_t bit = static_cast<std::uint64_t>(1) << k;
+		if (isPunct(p[k])) {
+			punct |= bit;
+		} else if (isSpace(p[k])) {
+			space |= bit;
+		}
+	}
+	masks._punct = punct;
+	masks._space = space;
+}
+
+#if SCAN_X86
+
+// Compares every byte to the character, giving 0xFF where they are equal.
+#define EQ128(v, c) _mm_cmpeq_epi8(v, _mm_set1_epi8(c))
+#define EQ256(v, c) _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))
+
+__attribute__((target("sse2")))
+static void classifySSE2(const char* p, CharMasks& masks) {
+	std::uint64_t punct = 0;
+	std::uint64_t space = 0;
+	for (unsigned int k = 0; k < block_size; k += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + k));
+		__m128i pu = _mm_or_si128(
+			_mm_or_si128(EQ128(v, '('), EQ128(v, ')')),
+			_mm_or_si128(_mm_or_si128(EQ128(v, '{'), EQ128(v, '}')),
+				EQ128(v, ',')));
+		__m128i sp = _mm_or_si128(
+			_mm_or_si128(EQ128(v, ' '), EQ128(v, '\t')),
+			_mm_or_si128(EQ128(v, '\n'), EQ128(v, '\r')));
+		punct |= static_cast<std::uint64_t>(
+			static_cast<std::uint32_t>(_mm_movemask_epi8(pu))) << k;
+		space |= static_cast<std::uint64_t>(
+			static_cast<std::uint32_t>(_mm_movemask_epi8(sp))) << k;
+	}
+	masks._punct = punct;
+	masks._space = space;
+}
+
+__attribute__((target("avx2")))
+static void classifyAVX2(const char* p, CharMasks& masks) {
+	std::uint64_t punct = 0;
+	std::uint64_t space = 0;
+	for (unsigned int k = 0; k < block_size; k += 32) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + k));
+		__m256i pu = _mm256_or_si256(
+			_mm256_or_si256(EQ256(v, '('), EQ256(v, ')')),
+			_mm256_or_si256(_mm256_or_si256(EQ256(v, '{'), EQ256(v, '}')),
+				EQ256(v, ',')));
+		__m256i sp = _mm256_or_si256(
+			_mm256_or_si256(EQ256(v, ' '), EQ256(v, '\t')),
+			_mm256_or_si256(EQ256(v, '\n'), EQ256(v, '\r')));
+		punct |= static_cast<std::uint64_t>(
+			static_cast<std::uint32_t>(_mm256_movemask_epi8(pu))) << k;
+		space |= static_cast<std::uint64_t>(
+			static_cast<std::uint32_t>(_mm256_movemask_epi8(sp))) << k;
+	}
+	masks._punct = punct;
+	masks._space = space;
+}
+
+#endif
+
+bool scanImplSupported(ScanImpl impl) {
+	switch (impl) {
+	case SCAN_SCALAR:
+		return true;
+#if SCAN_X86
+	case SCAN_SSE2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2");
+	case SCAN_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#else
+	default:
+		return false;
+#endif
+	}
+	return false;
+}
+
+// Returns the fastest supported implementation.
+static ScanImpl detectScanImpl() {
+	if (scanImplSupported(SCAN_AVX2)) return SCAN_AVX2;
+	if (scanImplSupported(SCAN_SSE2)) return SCAN_SSE2;
+	return SCAN_SCALAR;
+}
+
+ScanImpl bestScanImpl() {
+	static const ScanImpl best = detectScanImpl();
+	return best;
+}
+
+void classifyBlock(ScanImpl impl, const char* p, CharMasks& masks) {
+	switch (impl) {
+#if SCAN_X86
+	case SCAN_SSE2:
+		classifySSE2(p, masks);
+		return;
+	case SCAN_AVX2:
+		classifyAVX2(p, masks);
+		return;
+#endif
+	default:
+		classifyScalar(p, masks);
+		return;
+	}
+}
+
+// =============================================================================
+//            Token extraction
+// =============================================================================
+
+// Tokens are found from the masks without looking at characters again. A word
+// is a run of characters that are neither punctuation nor space. Comparing the
+// word mask to itself shifted by one position gives the positions where words
+// start and end, and together with the punctuation mask these are the events
+// that produce tokens, visited in order by repeatedly taking the lowest bit.
+void scanTokens(ScanImpl impl, const char* begin, const char* end,
+		std::vector<Token>& out) {
+	const char* start = nullptr; // the start of the current word
+	std::uint64_t carry = 0; // 1 if the previous block ended inside a word
+	char pad[block_size];
+	for (const char* p = begin; p < end; p += block_size) {
+		// Pad the last block with spaces so that it can be classified whole.
+		const char* block = p;
+		std::size_t n = static_cast<std::size_t>(end - p);
+		if (n < block_size) {
+			std::memcpy(pad, p, n);
+			std::memset(pad + n, ' ', block_size - n);
+			block = pad;
+		}
+		CharMasks masks;
+		classifyBlock(impl, block, masks);
+		std::uint64_t word = ~(masks._punct | masks._space);
+		std::uint64_t prev = (word << 1) | carry;
+		std::uint64_t starts = word & ~prev;
+		std::uint64_t ends = ~word & prev;
+		std::uint64_t events = starts | ends | masks._punct;
+		while (events != 0) {
+			unsigned int k = lowestBit(events);
+			std::uint64_t bit = static_cast<std::uint64_t>(1) << k;
+			if (ends & bit) {
+				out.emplace_back(start, static_cast<std::size_t>(p + k - start));
+			}
+			if (masks._punct & bit) {
+				out.emplace_back(p + k, 1);
+			}
+			if (starts & bit) {
+				start = p + k;
+			}
+			events &= events - 1;
+		}
+		carry = word >> (block_size - 1);
+	}
+	if (carry != 0) {
+		out.emplace_back(start, static_cast<std::size_t>(end - start));
+	}
+}
@@ -0,0 +1,40 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "token.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Character masks classify a block of 64 consecutive characters. Bit k of each
+// mask describes character k of the block.
+class CharMasks {
+public:
+	std::uint64_t _punct; // characters that always form their own token
+	std::uint64_t _space; // characters that separate tokens
+};
+
+// The ways of classifying characters. The vector versions handle 16 (SSE2) or
+// 32 (AVX2) characters per instruction, and are only usable on x86 processors
+// that support them.
+enum ScanImpl { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+
+// Returns the fastest implementation supported by this processor. It is
+// detected once, the first time this is called.
+ScanImpl bestScanImpl();
+
+// Returns true if the implementation can be used on this processor.
+bool scanImplSupported(ScanImpl impl);
+
+// Classifies the 64 characters starting at p, which must all be readable.
+void classifyBlock(ScanImpl impl, const char* p, CharMasks& masks);
+
+// Appends to out the tokens in [begin, end), split the same way as tokenize.
+// Each block of characters is classified with the given implementation, and
+// tokens are extracted from the resulting bitmasks.
+void scanTokens(ScanImpl impl, const char* begin, const char* end,
+	std::vector<Token>& out);
+
+#endif
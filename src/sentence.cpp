@@ -2,6 +2,9 @@
 
 #include "sentence.hpp"
 
+#include "encode.hpp"
+#include "eval.hpp"
+#include "hash.hpp"
 #include "object.hpp"
 
 #include <algorithm>
@@ -9,59 +12,46 @@
 
 #include <cassert>
 
-// =============================================================================
-//            Macros
-// =============================================================================
-
-// Adds a decomposition that only uses one child.
-#define DEC1(vec, s, gi, go) do { \
-	vec.emplace_back(s, gi, go); \
-} while (0)
-
-// Adds a decomposition to the vector.
-#define DEC2(vec, s, gi1, go1, gi2, go2) do { \
-	vec.emplace_back(s, gi1, go1, gi2, go2); \
-} while (0)
-
-// Add a deduction to the vector.
-#define DED(vec, hyp, conc) do { vec.emplace_back(hyp, conc); } while (0)
+namespace {
+	// The most elements a quantifier's domain can have for it to be evaluated.
+	const std::size_t quantifier_limit = 1 << 20;
+}
 
 // =============================================================================
 //            Decomp
 // =============================================================================
 
-Decomp::Decomp(std::string name, Sentence* givenA, Sentence* goalA,
-	Sentence* givenB, Sentence* goalB)
-	: _name(name), _givenA(givenA), _goalA(goalA), _givenB(givenB), _goalB(goalB) {}
-
-Decomp::Decomp(std::string name, Sentence* givenA, Sentence* goalA)
-	: _name(name), _givenA(givenA), _goalA(goalA), _givenB(nullptr), _goalB(nullptr)
-	{}
+Decomp::Decomp(const char* name, const Sentence* source, int rule)
+	: _name(name), _source(source), _rule(rule) {}
 
 void Decomp::print() const {
 	std::cout << _name;
 }
 
-void Decomp::free() {
-	delete _givenA;
-	delete _goalA;
-	delete _givenB;
-	delete _goalB;
+void Decomp::build(SentencePtr& givenA, SentencePtr& goalA,
+		SentencePtr& givenB, SentencePtr& goalB) const {
+	Sentence *gi1 = nullptr, *go1 = nullptr, *gi2 = nullptr, *go2 = nullptr;
+	_source->buildDecomp(_rule, gi1, go1, gi2, go2);
+	assert(go1 != nullptr);
+	givenA.reset(gi1);
+	goalA.reset(go1);
+	givenB.reset(gi2);
+	goalB.reset(go2);
 }
 
 // =============================================================================
 //            Deduct
 // =============================================================================
 
-Deduct::Deduct(Sentence* hyp, Sentence* conc) : _hyp(hyp), _conc(conc) {}
+Deduct::Deduct(const Sentence* source, int rule)
+	: _source(source), _rule(rule) {}
 
-void Deduct::free() {
-	delete _hyp;
-	delete _conc;
+SentencePtr Deduct::hypothesis() const {
+	return SentencePtr(_source->buildHypothesis(_rule));
 }
 
-void Deduct::print() const {
-	std::cout << *_conc;
+SentencePtr Deduct::conclusion() const {
+	return SentencePtr(_source->buildConclusion(_rule));
 }
 
 // =============================================================================
@@ -70,11 +60,37 @@ void Deduct::print() const {
 
 Sentence::~Sentence() {}
 
+Sentence::Value Sentence::value() const {
+	Env env;
+	return evaluate(env);
+}
+
+const Object* Sentence::membership(bool) const {
+	return nullptr;
+}
+
+void Sentence::buildDecomp(int, Sentence*&, Sentence*&, Sentence*&,
+		Sentence*&) const {
+	assert(false);
+}
+
+Sentence* Sentence::buildHypothesis(int) const {
+	return nullptr;
+}
+
+Sentence* Sentence::buildConclusion(int) const {
+	assert(false);
+	return nullptr;
+}
+
 std::ostream& operator<<(std::ostream& stream, const Sentence& s) {
 	return s.print(stream);
 }
 
-// Convenience function for cloning and negating all at once.
+// Convenience function for cloning and negating all at once. The negation is
+// constant time, but the copy is not: it takes time linear in the size of s.
+// Sharing s instead would not be safe, since settling a negation changes the
+// children in place, and the decomposed sentence stays in the proof tree.
 static Sentence* negClone(Sentence* s) {
 	Sentence* n = s->clone();
 	n->negate();
@@ -97,28 +113,44 @@ Sentence* Logical::clone() const {
 }
 
 Logical* Logical::cloneSelf() const {
+	settle();
 	return new Logical(_type, _a->clone(), _b->clone());
 }
 
-Sentence::Value Logical::value() const {
-	Value va = _a->value();
-	Value vb = _b->value();
-	if (va == MU || vb == MU) {
-		return MU;
-	}
-	switch(_type) {
+Sentence::Value Logical::evaluate(Env& env) const {
+	settle();
+	// The second operand is skipped when the first one decides the result.
+	Value va = _a->evaluate(env);
+	switch (_type) {
 	case AND:
-		return static_cast<Value>(va && vb);
+		return va == FALSE ? va : valueAnd(va, _b->evaluate(env));
 	case OR:
-		return static_cast<Value>(va || vb);
+		return va == TRUE ? va : valueOr(va, _b->evaluate(env));
 	case IMPLIES:
-		return static_cast<Value>(!va || vb);
-	case IFF:
-		return static_cast<Value>(va == vb);
+		return va == FALSE ? TRUE : valueOr(valueNot(va), _b->evaluate(env));
+	case IFF: {
+		Value vb = _b->evaluate(env);
+		return va == MU || vb == MU ? MU : static_cast<Value>(va == vb);
+	}
+	}
+	return MU;
+}
+
+const Object* Logical::domain(bool universal) const {
+	settle();
+	switch (_type) {
+	case AND: return universal ? nullptr : _a->membership(true);
+	case OR: return universal ? _a->membership(false) : nullptr;
+	case IMPLIES: return universal ? _a->membership(true) : nullptr;
+	case IFF: return nullptr;
 	}
+	return nullptr;
 }
 
-void Logical::negate() {
+// Negation follows De Morgan's laws, and (not (=> a b)) is (and a (not b)).
+// The negation of (iff a b) is (iff a (not b)), which avoids copying both
+// operands to split it into two implications.
+void Logical::pushNegation() const {
 	switch (_type) {
 	case AND:
 		_type = OR;
@@ -135,85 +167,147 @@ void Logical::negate() {
 		_b->negate();
 		break;
 	case IFF:
-		_type = AND;
-		Logical* fwd = new Logical(IMPLIES, _a, _b);
-		Logical* bwd = new Logical(IMPLIES, _b->clone(), _a->clone());
-		_a = fwd;
-		_b = bwd;
-		negate();
+		_b->negate();
 		break;
 	}
 }
 
+void Logical::fold() {
+	_a->fold();
+	_b->fold();
+	_hash = 0;
+}
+
+void Logical::abstract(unsigned int id, unsigned int depth) {
+	_a->abstract(id, depth);
+	_b->abstract(id, depth);
+	_hash = 0;
+}
+
+void Logical::substitute(unsigned int depth, const Object& term) {
+	_a->substitute(depth, term);
+	_b->substitute(depth, term);
+	_hash = 0;
+}
+
 std::vector<Decomp> Logical::decompose() const {
+	settle();
 	std::vector<Decomp> vec;
 	switch (_type) {
 	case AND:
-		DEC2(vec, "separate", nullptr, _a->clone(), nullptr, _b->clone());
+		vec.emplace_back("separate", this, 0);
 		break;
 	case OR:
-		DEC1(vec, "first", negClone(_b), _a->clone());
-		DEC1(vec, "second", negClone(_a), _b->clone());
+		vec.emplace_back("first", this, 0);
+		vec.emplace_back("second", this, 1);
 		break;
 	case IMPLIES:
-		DEC1(vec, "direct", _a->clone(), _b->clone());
-		DEC1(vec, "contrapositive", negClone(_b), negClone(_a));
+		vec.emplace_back("direct", this, 0);
+		vec.emplace_back("contrapositive", this, 1);
 		break;
 	case IFF:
-		Logical* fwd = new Logical(IMPLIES, _a->clone(), _b->clone());
-		Logical* bwd = new Logical(IMPLIES, _b->clone(), _a->clone());
-		DEC2(vec, "bidirectional", nullptr, fwd, nullptr, bwd);
+		vec.emplace_back("bidirectional", this, 0);
 		break;
 	}
 	return vec;
 }
 
-std::vector<Deduct> Logical::deduce() const {
-	std::vector<Deduct> vec;
+void Logical::buildDecomp(int rule, Sentence*& givenA, Sentence*& goalA,
+		Sentence*&, Sentence*& goalB) const {
+	settle();
 	switch (_type) {
 	case AND:
-		DED(vec, nullptr, _a->clone());
-		DED(vec, nullptr, _b->clone());
+		goalA = _a->clone();
+		goalB = _b->clone();
 		break;
 	case OR:
-		DED(vec, negClone(_a), _b->clone());
-		DED(vec, negClone(_b), _a->clone());
+		givenA = negClone(rule == 0 ? _b : _a);
+		goalA = (rule == 0 ? _a : _b)->clone();
 		break;
 	case IMPLIES:
-		DED(vec, _a->clone(), _b->clone());
-		DED(vec, negClone(_b), negClone(_a));
+		givenA = (rule == 0) ? _a->clone() : negClone(_b);
+		goalA = (rule == 0) ? _b->clone() : negClone(_a);
 		break;
 	case IFF:
-		Logical* fwd = new Logical(IMPLIES, _a->clone(), _b->clone());
-		Logical* bwd = new Logical(IMPLIES, _b->clone(), _a->clone());
-		DED(vec, nullptr, fwd);
-		DED(vec, nullptr, bwd);
+		goalA = new Logical(IMPLIES, _a->clone(), _b->clone());
+		goalB = new Logical(IMPLIES, _b->clone(), _a->clone());
 		break;
 	}
+}
+
+std::vector<Deduct> Logical::deduce() const {
+	std::vector<Deduct> vec;
+	vec.emplace_back(this, 0);
+	vec.emplace_back(this, 1);
 	return vec;
 }
 
-std::ostream& Logical::print(std::ostream& s) const {
-	s << '(';
+Sentence* Logical::buildHypothesis(int rule) const {
+	settle();
 	switch (_type) {
-	case AND: s << "and"; break;
-	case OR: s << "or"; break;
-	case IMPLIES: s << "=>"; break;
-	case IFF: s << "iff"; break;
+	case AND:
+	case IFF:
+		return nullptr;
+	case OR:
+		return negClone(rule == 0 ? _a : _b);
+	case IMPLIES:
+		return (rule == 0) ? _a->clone() : negClone(_b);
 	}
-	s << ' ';
+	return nullptr;
+}
+
+Sentence* Logical::buildConclusion(int rule) const {
+	settle();
+	switch (_type) {
+	case AND:
+		return (rule == 0 ? _a : _b)->clone();
+	case OR:
+		return (rule == 0 ? _b : _a)->clone();
+	case IMPLIES:
+		return (rule == 0) ? _b->clone() : negClone(_a);
+	case IFF:
+		return (rule == 0)
+			? new Logical(IMPLIES, _a->clone(), _b->clone())
+			: new Logical(IMPLIES, _b->clone(), _a->clone());
+	}
+	return nullptr;
+}
+
+const char* Logical::name(Type t) {
+	switch (t) {
+	case AND: return "and";
+	case OR: return "or";
+	case IMPLIES: return "=>";
+	case IFF: return "iff";
+	}
+	return "";
+}
+
+std::ostream& Logical::print(std::ostream& s) const {
+	settle();
+	s << '(' << name(_type) << ' ';
 	_a->print(s);
 	s << ' ';
 	_b->print(s);
 	return s << ')';
 }
 
-int Logical::getType(const std::string& s) {
-	if (s == "and") return AND;
-	if (s == "or") return OR;
-	if (s == "=>") return IMPLIES;
-	if (s == "iff") return IFF;
-	return -1;
+void Logical::encode(Encoder& e) const {
+	settle();
+	_a->encode(e);
+	_b->encode(e);
+	e.node(FLAT_LOGICAL, _type, false, 0);
+}
+
+bool Logical::equalSelf(const Sentence& other) const {
+	auto s = dynamic_cast<const Logical*>(&other);
+	return s != nullptr && s->_type == _type
+		&& s->_a->equal(*_a) && s->_b->equal(*_b);
+}
+
+std::uint64_t Logical::computeHash() const {
+	std::uint64_t h = hashMix(FLAT_LOGICAL, _type);
+	return hashMix(hashMix(h, _a->hash()), _b->hash());
 }
 
 // =============================================================================
@@ -233,56 +327,94 @@ Sentence* Relation::clone() const {
 }
 
 Relation* Relation::cloneSelf() const {
+	settle();
 	return new Relation(_type, _want, _a->clone(), _b->clone());
 }
 
-Sentence::Value Relation::value() const {
-	return Sentence::MU;
+Sentence::Value Relation::evaluate(Env& env) const {
+	settle();
+	Value v = MU;
+	switch (_type) {
+	case EQ:
+		v = evalEqual(*_a, *_b, env);
+		break;
+	case LT:
+	case LTE:
+	case DIV: {
+		Integer x, y;
+		if (!_a->evaluate(x, env) || !_b->evaluate(y, env)) {
+			break;
+		}
+		if (_type == LT) {
+			v = static_cast<Value>(x < y);
+		} else if (_type == LTE) {
+			v = static_cast<Value>(x <= y);
+		} else {
+			v = static_cast<Value>(x == 0 ? y == 0 : y % x == 0);
+		}
+		break;
+	}
+	case SEQ:
+		v = valueAnd(evalSubset(*_a, *_b, env), evalSubset(*_b, *_a, env));
+		break;
+	case SUB:
+		v = valueAnd(evalSubset(*_a, *_b, env),
+			valueNot(evalSubset(*_b, *_a, env)));
+		break;
+	case SUBE:
+		v = evalSubset(*_a, *_b, env);
+		break;
+	case IN:
+		v = evalIn(*_a, *_b, env);
+		break;
+	}
+	return _want ? v : valueNot(v);
+}
+
+const Object* Relation::membership(bool positive) const {
+	settle();
+	auto sym = objectCast<Symbol>(_a);
+	if (_type != IN || _want != positive || sym == nullptr
+			|| sym->index() != 1) {
+		return nullptr;
+	}
+	return _b->isSet() ? _b : nullptr;
 }
 
-void Relation::negate() {
+void Relation::pushNegation() const {
 	_want = !_want;
 }
 
+void Relation::fold() {
+	foldInto(_a);
+	foldInto(_b);
+	_hash = 0;
+}
+
+void Relation::abstract(unsigned int id, unsigned int depth) {
+	_a->abstract(id, depth);
+	_b->abstract(id, depth);
+	_hash = 0;
+}
+
+void Relation::substitute(unsigned int depth, const Object& term) {
+	substituteInto(_a, depth, term);
+	substituteInto(_b, depth, term);
+	_hash = 0;
+}
+
 std::vector<Decomp> Relation::decompose() const {
+	settle();
 	std::vector<Decomp> vec;
 	if (_want) {
 		switch (_type) {
-		case SEQ: {
-			Relation* fwd = new Relation(SUB, true, _a->clone(), _b->clone());
-			Relation* bwd = new Relation(SUB, true, _b->clone(), _a->clone());
-			DEC2(vec, "mutual subsets", nullptr, fwd, nullptr, bwd);
+		case SEQ:
+			vec.emplace_back("mutual subsets", this, 0);
 			break;
-		}
-		case SUB: {
-			Symbol* var = new Symbol('x');
-			DEC1(vec, "definition", nullptr, new Quantified(
-				Quantified::FORALL,
-				var,
-				dynamic_cast<Set*>(_a->clone()),
-				new Relation(Relation::IN, true, var->cloneSelf(), _b->clone()) 
-			));
-			break;
-		}
-		case DIV: {
-			Symbol* var = new Symbol('k');
-			DEC1(vec, "definition", nullptr, new Quantified(
-				Quantified::EXISTS,
-				var,
-				new SpecialSet(SpecialSet::INTEGERS),
-				new Relation(
-					Relation::EQ,
-					true,
-					new CompoundNumber(
-						CompoundNumber::MUL,
-						var->cloneSelf(),
-						dynamic_cast<Number*>(_a->clone())
-					),
-					_b->clone()
-				)
-			));
+		case SUB:
+		case DIV:
+			vec.emplace_back("definition", this, 0);
 			break;
-		}
 		default:
 			break;
 		}
@@ -290,79 +422,118 @@ std::vector<Decomp> Relation::decompose() const {
 	return vec;
 }
 
+void Relation::buildDecomp(int, Sentence*&, Sentence*& goalA,
+		Sentence*&, Sentence*& goalB) const {
+	settle();
+	switch (_type) {
+	case SEQ:
+		goalA = new Relation(SUB, true, _a->clone(), _b->clone());
+		goalB = new Relation(SUB, true, _b->clone(), _a->clone());
+		break;
+	case SUB: {
+		Symbol* var = new Symbol("x");
+		goalA = new Quantified(
+			Quantified::FORALL,
+			var,
+			_a->clone(),
+			new Relation(Relation::IN, true, var->cloneSelf(), _b->clone())
+		);
+		break;
+	}
+	case DIV: {
+		Symbol* var = new Symbol("k");
+		goalA = new Quantified(
+			Quantified::EXISTS,
+			var,
+			new SpecialSet(SpecialSet::INTEGERS),
+			new Relation(
+				Relation::EQ,
+				true,
+				new CompoundNumber(
+					CompoundNumber::MUL,
+					var->cloneSelf(),
+					_a->clone()
+				),
+				_b->clone()
+			)
+		);
+		break;
+	}
+	default:
+		assert(false);
+		break;
+	}
+}
+
 std::vector<Deduct> Relation::deduce() const {
+	settle();
 	std::vector<Deduct> vec;
-	Relation* r;
-	if (_want) {
-		switch (_type) {
-		case EQ:
-			r = cloneSelf();
-			r->_type = LTE;
-			DED(vec, nullptr, r);
-			break;
-		case LT:
-			r = cloneSelf();
-			r->_type = EQ;
-			r->_want = false;
-			DED(vec, nullptr, r);
-			break;
-		default:
-			break;
-		}
+	if (_want && (_type == EQ || _type == LT)) {
+		vec.emplace_back(this, 0);
 	}
 	return vec;
 }
 
-std::ostream& Relation::print(std::ostream& s) const {
-	s << '(';
-	if (_want) {
-		switch (_type) {
-		case EQ: s << '='; break;
-		case LT: s << '<'; break;
-		case LTE: s << "<="; break;
-		case SEQ: s << "s="; break;
-		case SUB: s << "sub"; break;
-		case SUBE: s << "sube"; break;
-		case IN: s << "in"; break;
-		case DIV: s << "div"; break;
+// Equality gives (<= a b), and (< a b) gives (not (= a b)).
+Sentence* Relation::buildConclusion(int) const {
+	settle();
+	bool eq = _type == EQ;
+	return new Relation(eq ? LTE : EQ, eq, _a->clone(), _b->clone());
+}
+
+const char* Relation::name(Type t, bool positive) {
+	if (positive) {
+		switch (t) {
+		case EQ: return "=";
+		case LT: return "<";
+		case LTE: return "<=";
+		case SEQ: return "s=";
+		case SUB: return "sub";
+		case SUBE: return "sube";
+		case IN: return "in";
+		case DIV: return "div";
 		}
 	} else {
-		switch (_type) {
-		case EQ: s << "!="; break;
-		case LT: s << ">="; break;
-		case LTE: s << ">"; break;
-		case SEQ: s << "s!="; break;
-		case SUB: s << "supe"; break;
-		case SUBE: s << "sup"; break;
-		case IN: s << "notin"; break;
-		case DIV: s << "notdiv"; break;
+		switch (t) {
+		case EQ: return "!=";
+		case LT: return ">=";
+		case LTE: return ">";
+		case SEQ: return "s!=";
+		case SUB: return "supe";
+		case SUBE: return "sup";
+		case IN: return "notin";
+		case DIV: return "notdiv";
 		}
 	}
-	s << ' ';
+	return "";
+}
+
+std::ostream& Relation::print(std::ostream& s) const {
+	settle();
+	s << '(' << name(_type, _want) << ' ';
 	_a->print(s);
 	s << ' ';
 	_b->print(s);
 	return s << ')';
 }
 
-std::pair<int, bool> Relation::getType(const std::string& s) {
-	if (s == "=") return {EQ, true};
-	if (s == "!=") return {EQ, false};
-	if (s == "<") return {LT, true};
-	if (s == ">=") return {LT, false};
-	if (s == "<=") return {LTE, true};
-	if (s == ">") return {LTE, false};
-	if (s == "s=") return {SEQ, true};
-	if (s == "s!=") return {SEQ, false};
-	if (s == "sub") return {SUB, true};
-	if (s == "supe") return {SUB, false};
-	if (s == "sube") return {SUBE, true};
-	if (s == "sup") return {SUBE, false};
-	if (s == "in") return {IN, true};
-	if (s == "notin") return {IN, false};
-	if (s == "div") return {DIV, true};
-	if (s == "notdiv") return {DIV, false};
-	return {-1, true};
+void Relation::encode(Encoder& e) const {
+	settle();
+	_a->encode(e);
+	_b->encode(e);
+	e.node(FLAT_RELATION, _type, _want, 0);
+}
+
+bool Relation::equalSelf(const Sentence& other) const {
+	auto s = dynamic_cast<const Relation*>(&other);
+	return s != nullptr && s->_type == _type && s->_want == _want
+		&& s->_a->equal(*_a) && s->_b->equal(*_b);
+}
+
+std::uint64_t Relation::computeHash() const {
+	std::uint64_t h = hashMix(FLAT_RELATION,
+		static_cast<unsigned int>(_type) << 1 | _want);
+	return hashMix(hashMix(h, _a->hash()), _b->hash());
 }
 
 // =============================================================================
@@ -374,17 +545,24 @@ std::pair<int, bool> Relation::getType(const std::string& s) {
 // simplifies things and makes everything more consistent.
 
 Quantified::Quantified(Type t, Symbol* var, Sentence* body)
-	: _type(t), _var(var), _body(body) {}
+		: _type(t), _var(var), _body(body) {
+	_body->abstract(_var->id(), 1);
+}
 
-Quantified::Quantified(Type t, Symbol* var, Set* domain, Sentence* body)
+Quantified::Quantified(Type t, Symbol* var, Object* domain,
+		Sentence* body)
 		: _type(t), _var(var) {
 	_body = new Logical(
 		(_type == FORALL) ? Logical::IMPLIES : Logical::AND,
 		new Relation(Relation::IN, true, var->clone(), domain),
 		body
 	);
+	_body->abstract(_var->id(), 1);
 }
 
+Quantified::Quantified(Type t, Symbol* var, Sentence* body, bool)
+	: _type(t), _var(var), _body(body) {}
+
 Quantified::~Quantified() {
 	delete _var;
 	delete _body;
@@ -395,55 +573,135 @@ Sentence* Quantified::clone() const {
 }
 
 Quantified* Quantified::cloneSelf() const {
-	return new Quantified(_type, _var->cloneSelf(), _body->clone());
+	settle();
+	return new Quantified(_type, _var->cloneSelf(), _body->clone(), true);
+}
+
+Sentence::Value Quantified::evaluate(Env& env) const {
+	settle();
+	// Only quantifiers restricted to a finite set can be evaluated, by trying
+	// each element in turn.
+	auto logical = dynamic_cast<const Logical*>(_body);
+	const Object* dom = logical == nullptr
+		? nullptr : logical->domain(_type == FORALL);
+	if (dom == nullptr) {
+		return MU;
+	}
+	// A counterexample decides a universal statement, and a witness decides an
+	// existential one.
+	const Value decisive = _type == FORALL ? FALSE : TRUE;
+	Value result = valueNot(decisive);
+	bool finite = forEachElement(*dom, env, quantifier_limit,
+		[&](const Object& x) {
+			if (!env.spend()) {
+				result = MU;
+				return false;
+			}
+			std::unique_ptr<Object> closed(x.bindValues(env));
+			env.push(_var->id(), closed != nullptr ? closed.get() : &x);
+			Value v = _body->evaluate(env);
+			env.pop();
+			if (v == decisive) {
+				result = v;
+				return false;
+			}
+			if (v == MU) {
+				result = v;
+			}
+			return true;
+		});
+	return finite ? result : MU;
+}
+
+void Quantified::pushNegation() const {
+	_type = static_cast<Type>(!_type);
+	_body->negate();
 }
 
-Sentence::Value Quantified::value() const {
-	return Sentence::MU;
+void Quantified::fold() {
+	_body->fold();
+	_hash = 0;
 }
 
-void Quantified::negate() {
-	_type = static_cast<Type>(!_type);
-	_body->negate();
+void Quantified::abstract(unsigned int id, unsigned int depth) {
+	_body->abstract(id, depth + 1);
+	_hash = 0;
+}
+
+void Quantified::substitute(unsigned int depth, const Object& term) {
+	_body->substitute(depth + 1, term);
+	_hash = 0;
+}
+
+SentencePtr Quantified::instantiate(const Object& term) const {
+	settle();
+	SentencePtr s(_body->clone());
+	s->substitute(1, term);
+	return s;
 }
 
 std::vector<Decomp> Quantified::decompose() const {
+	settle();
 	std::vector<Decomp> vec;
 	if (_type == FORALL) {
-		DEC1(vec, "general", nullptr, _body->clone());
+		vec.emplace_back("general", this, 0);
 	}
 	return vec;
 }
 
-// TODO: differentiate universal & existential instantiation
+// To prove a universal statement, prove the body for an arbitrary object, a
+// fresh symbol that nothing else is known about.
+void Quantified::buildDecomp(int, Sentence*&, Sentence*& goalA,
+		Sentence*&, Sentence*&) const {
+	std::unique_ptr<Symbol> x(_var->fresh());
+	goalA = instantiate(*x).release();
+}
+
+// A universal statement holds for its variable, which can then be used like
+// any other free symbol. An existential statement only holds for some witness,
+// so it is instantiated with a fresh symbol standing for that witness. The rule
+// is the quantifier type.
 std::vector<Deduct> Quantified::deduce() const {
+	settle();
 	std::vector<Deduct> vec;
-	switch (_type) {
-	case FORALL:
-		DED(vec, nullptr, _body->clone());
-		break;
-	case EXISTS:
-		DED(vec, nullptr, _body->clone());
-		break;
-	}
+	vec.emplace_back(this, _type);
 	return vec;
 }
 
-std::ostream& Quantified::print(std::ostream& s) const {
-	s << '(';
-	switch (_type) {
-	case FORALL: s << "forall"; break;
-	case EXISTS: s << "exists"; break;
+Sentence* Quantified::buildConclusion(int rule) const {
+	if (rule == FORALL) {
+		return instantiate(*_var).release();
 	}
-	s << ' ';
+	std::unique_ptr<Symbol> witness(_var->fresh());
+	return instantiate(*witness).release();
+}
+
+const char* Quantified::name(Type t) {
+	return t == FORALL ? "forall" : "exists";
+}
+
+std::ostream& Quantified::print(std::ostream& s) const {
+	settle();
+	s << '(' << name(_type) << ' ';
 	_var->print(s);
 	s << ' ';
 	_body->print(s);
 	return s << ')';
 }
 
-int Quantified::getType(const std::string& s) {
-	if (s == "forall") return FORALL;
-	if (s == "exists") return EXISTS;
-	return -1;
+void Quantified::encode(Encoder& e) const {
+	settle();
+	_var->encode(e);
+	_body->encode(e);
+	e.node(FLAT_QUANTIFIED, _type, false, 0);
+}
+
+// The variable is only a name, since the body refers to it by index.
+bool Quantified::equalSelf(const Sentence& other) const {
+	auto s = dynamic_cast<const Quantified*>(&other);
+	return s != nullptr && s->_type == _type && s->_body->equal(*_body);
+}
+
+std::uint64_t Quantified::computeHash() const {
+	return hashMix(hashMix(FLAT_QUANTIFIED, _type), _body->hash());
 }
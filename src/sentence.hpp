@@ -3,51 +3,76 @@
 #ifndef SENTENCE_H
 #define SENTENCE_H
 
-#include <string>
+#include "arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
 #include <vector>
 
+class Encoder;
+class Env;
 class Object;
 class Sentence;
-class Set;
 class Symbol;
 
-// A decomp stores information about sentence decomposition. It breaks down a
-// parent sentence into one equivalent goal (A) or two subgoals (A and B). Each
-// subgoal can optionally include a given (a fact to be used in the proof).
+// A unique handle to a sentence. Sentences are passed between the parser, the
+// decompositions, and the proof tree by moving handles, so that ownership is
+// transferred rather than the sentences being cloned.
+typedef std::unique_ptr<Sentence> SentencePtr;
+
+// A decomp describes a way of decomposing a parent sentence into one
+// equivalent goal (A) or two subgoals (A and B). Each subgoal can optionally
+// include a given (a fact to be used in the proof). It only refers to the
+// parent and the rule, so listing the options is cheap: the sentences are only
+// built for the option that is chosen. Decomps can be moved but not copied.
 class Decomp {
 public:
-	Decomp(std::string name, Sentence* givenA, Sentence* goalA,
-		Sentence* givenB, Sentence* goalB);
-	Decomp(std::string name, Sentence* givenA, Sentence* givenB);
+	Decomp(const char* name, const Sentence* source, int rule);
+	Decomp(Decomp&&) = default;
+	Decomp& operator=(Decomp&&) = default;
 
 	// Prints the name of this decomposition.
 	void print() const;
 
-	// Deletes all four of its sentences.
-	void free();
+	// Builds the goals and givens of this decomposition. The ones it does not
+	// have (givens, or the second goal) are set to null. The source sentence
+	// must still exist.
+	void build(SentencePtr& givenA, SentencePtr& goalA,
+		SentencePtr& givenB, SentencePtr& goalB) const;
 
-	std::string _name; // the type of decomposition
-	Sentence* _givenA; // first given, or null
-	Sentence* _goalA; // first goal
-	Sentence* _givenB; // second given, or null
-	Sentence* _goalB; // second goal, or null
+	const char* _name; // the type of decomposition
+	const Sentence* _source; // the sentence being decomposed
+	int _rule; // identifies the decomposition to the source
+
+private:
+	Decomp(const Decomp&) = delete;
+	Decomp& operator=(const Decomp&) = delete;
 };
 
-// A deduct stores information about sentence deduction. It consists of
-// conclusion (the thing being deduced) and an optional hypothesis, which is
-// required to be proved before assuming the conclusion.
+// A deduct describes a deduction from a sentence. It consists of a conclusion
+// (the thing being deduced) and an optional hypothesis, which is required to be
+// proved before assuming the conclusion. Like a decomp, it only refers to the
+// source sentence, and the sentences are built on demand. Deducts can be moved
+// but not copied.
 class Deduct {
 public:
-	Deduct(Sentence* hyp, Sentence* conc);
+	Deduct(const Sentence* source, int rule);
+	Deduct(Deduct&&) = default;
+	Deduct& operator=(Deduct&&) = default;
 
-	// Prints the conclusion of this deduction.
-	void print() const;
+	// Builds the hypothesis (or returns null if there is none) or the
+	// conclusion of this deduction.
+	SentencePtr hypothesis() const;
+	SentencePtr conclusion() const;
 
-	// Deletes both of its sentences.
-	void free();
+	const Sentence* _source; // the sentence deduced from
+	int _rule; // identifies the deduction to the source
 
-	Sentence* _hyp; // the requirement, or null
-	Sentence* _conc; // the deduced sentence
+private:
+	Deduct(const Deduct&) = delete;
+	Deduct& operator=(const Deduct&) = delete;
 };
 
 // A sentence, or proposition, is a Boolean-valued formula with no free
@@ -64,28 +89,135 @@ public:
 	// Creates a deep copy of the sentence.
 	virtual Sentence* clone() const = 0;
 
-	// Evaluates the sentence and returns its truth value.
-	virtual Value value() const = 0;
+	// Evaluates the sentence and returns its truth value. This is MU unless
+	// the sentence is ground, or it only quantifies over finite sets.
+	Value value() const;
 
-	// Negates the meaning of the sentence, so that it becomes true where it
-	// used to be false, and vice versa. The implementation should propagate the
-	// negation as far as possible and try to express the result in a positive
-	// form, rather than simply wrapping the whole sentence in a logical NOT.
-	virtual void negate() = 0;
+	// Evaluates the sentence with symbols bound to the values in env. Each
+	// value a quantifier tries uses up a step of the environment's budget.
+	virtual Value evaluate(Env& env) const = 0;
 
-	// Returns a the possible decompositions of the sentence (possibly none).
+	// If the sentence has the form (in x S), where x is the variable of the
+	// nearest enclosing quantifier, or (notin x S) when positive is false,
+	// returns S. Otherwise, returns null.
+	virtual const Object* membership(bool positive) const;
+
+	// Negates the meaning of the sentence, so that it becomes true where it
+	// used to be false, and vice versa. This takes constant time: it only flips
+	// the polarity of the sentence. The negation is pushed down one level the
+	// next time the sentence is inspected (see settle), and it is expressed in
+	// a positive form rather than by wrapping the sentence in a logical NOT.
+	void negate() {
+		_negated = !_negated;
+		_hash = 0;
+	}
+
+	// Folds ground arithmetic within the sentence, in place, so that each
+	// compound number with no symbols becomes a concrete number.
+	virtual void fold() = 0;
+
+	// Binds or substitutes symbols within the sentence, in place, as described
+	// for Object::abstract and Object::substitute. Each quantifier passed on
+	// the way down adds one to the depth.
+	virtual void abstract(unsigned int id, unsigned int depth) = 0;
+	virtual void substitute(unsigned int depth, const Object& term) = 0;
+
+	// Returns the possible decompositions of the sentence (possibly none).
 	virtual std::vector<Decomp> decompose() const = 0;
 
-	// Returns the possible deductions from this sentence (possible none).
+	// Returns the possible deductions from this sentence (possibly none).
 	virtual std::vector<Deduct> deduce() const = 0;
 
 	// Prints a string representation of the sentence to the given stream.
 	virtual std::ostream& print(std::ostream& s) const = 0;
 	friend std::ostream& operator<<(std::ostream& stream, const Sentence& s);
 
+	// Appends the flat postfix encoding of the sentence to the encoder.
+	virtual void encode(Encoder& e) const = 0;
+
+	// Sentences are allocated from the current arena, if there is one.
+	static void* operator new(std::size_t size) { return allocNode(size); }
+	static void operator delete(void* p) { freeNode(p); }
+
+	// Returns true if the sentence is structurally equal to the other one.
+	bool equal(const Sentence& other) const {
+		return this == &other || (hash() == other.hash() && equalSelf(other));
+	}
+
+	// Returns a 64-bit structural hash of the sentence. Equal sentences have
+	// equal hashes. It is computed the first time it is needed and then cached
+	// until the sentence is negated.
+	std::uint64_t hash() const {
+		if (_hash == 0) {
+			settle();
+			_hash = computeHash() | 1;
+		}
+		return _hash;
+	}
+
 protected:
-	Sentence() {}
+	friend class Decomp;
+	friend class Deduct;
+
+	Sentence() : _hash(0), _negated(false) {}
 	Sentence(const Sentence&) = delete;
+
+	// Pushes a pending negation into the fields of the sentence, so that they
+	// can be read. Every method that looks at the fields calls this first. It
+	// takes constant time, since the children are only negated lazily too.
+	void settle() const {
+		if (_negated) {
+			_negated = false;
+			pushNegation();
+		}
+	}
+
+	// Changes the fields of the sentence to express its negation.
+	virtual void pushNegation() const = 0;
+
+	// Builds the sentences for the decomposition or deduction with the given
+	// rule, which is its index in the vector returned by decompose or deduce.
+	// The decomp outputs start out null.
+	virtual void buildDecomp(int rule, Sentence*& givenA, Sentence*& goalA,
+		Sentence*& givenB, Sentence*& goalB) const;
+	virtual Sentence* buildHypothesis(int rule) const;
+	virtual Sentence* buildConclusion(int rule) const;
+
+	// Compares the sentence to another whose hash is known to be the same.
+	virtual bool equalSelf(const Sentence& other) const = 0;
+
+	// Computes the structural hash of the sentence.
+	virtual std::uint64_t computeHash() const = 0;
+
+	mutable std::uint64_t _hash; // the cached hash, or 0 (always 0 if negated)
+	mutable bool _negated; // true if a negation has not been pushed down yet
+};
+
+// Three-valued logical operations. In AND, FALSE wins over MU, and in OR, TRUE
+// wins over MU.
+inline Sentence::Value valueNot(Sentence::Value v) {
+	return v == Sentence::MU ? v : static_cast<Sentence::Value>(!v);
+}
+inline Sentence::Value valueAnd(Sentence::Value a, Sentence::Value b) {
+	if (a == Sentence::FALSE || b == Sentence::FALSE) return Sentence::FALSE;
+	if (a == Sentence::MU || b == Sentence::MU) return Sentence::MU;
+	return Sentence::TRUE;
+}
+inline Sentence::Value valueOr(Sentence::Value a, Sentence::Value b) {
+	return valueNot(valueAnd(valueNot(a), valueNot(b)));
+}
+
+// Hashes and compares sentence pointers structurally, so that they can be used
+// as keys in unordered containers.
+struct SentenceHash {
+	std::size_t operator()(const Sentence* s) const {
+		return static_cast<std::size_t>(s->hash());
+	}
+};
+struct SentenceEqual {
+	bool operator()(const Sentence* a, const Sentence* b) const {
+		return a->equal(*b);
+	}
 };
 
 // Logical sentences are the building blocks of the propositional calculus.
@@ -102,17 +234,36 @@ public:
 	virtual ~Logical();
 	Logical* cloneSelf() const;
 	virtual Sentence* clone() const;
-	virtual Value value() const;
-	virtual void negate();
+	virtual Value evaluate(Env& env) const;
+	virtual void fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual void substitute(unsigned int depth, const Object& term);
 	virtual std::vector<Decomp> decompose() const;
 	virtual std::vector<Deduct> deduce() const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
 
-	// Returns the operation type specified by the string, or -1 otherwise.
-	static int getType(const std::string& s);
+	// If the sentence restricts the variable of the nearest enclosing
+	// quantifier to a set in the way the domain shorthand of a universal (or
+	// existential) quantifier does, returns that set. This includes the form a
+	// universal restriction takes after negation twice, (or (notin x S) P).
+	// Otherwise, returns null.
+	const Object* domain(bool universal) const;
+
+	// Returns the operator printed for the type.
+	static const char* name(Type t);
+
+protected:
+	virtual bool equalSelf(const Sentence& other) const;
+	virtual std::uint64_t computeHash() const;
+	virtual void pushNegation() const;
+	virtual void buildDecomp(int rule, Sentence*& givenA, Sentence*& goalA,
+		Sentence*& givenB, Sentence*& goalB) const;
+	virtual Sentence* buildHypothesis(int rule) const;
+	virtual Sentence* buildConclusion(int rule) const;
 
 private:
-	Type _type; // the operation type
+	mutable Type _type; // the operation type
 	Sentence* _a; // the first operand
 	Sentence* _b; // the second operand
 };
@@ -133,51 +284,91 @@ public:
 	virtual ~Relation();
 	Relation* cloneSelf() const;
 	virtual Sentence* clone() const;
-	virtual Value value() const;
-	virtual void negate();
+	virtual Value evaluate(Env& env) const;
+	virtual void fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual void substitute(unsigned int depth, const Object& term);
 	virtual std::vector<Decomp> decompose() const;
 	virtual std::vector<Deduct> deduce() const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+	virtual const Object* membership(bool positive) const;
 
-	// Returns the operation type specified by the string, or -1 otherwise.
-	static std::pair<int, bool> getType(const std::string& s);
+	// Returns the operator printed for the type, or for its negation if
+	// positive is false.
+	static const char* name(Type t, bool positive);
+
+protected:
+	virtual bool equalSelf(const Sentence& other) const;
+	virtual std::uint64_t computeHash() const;
+	virtual void pushNegation() const;
+	virtual void buildDecomp(int rule, Sentence*& givenA, Sentence*& goalA,
+		Sentence*& givenB, Sentence*& goalB) const;
+	virtual Sentence* buildConclusion(int rule) const;
 
 private:
 	Type _type; // the operation type
-	bool _want; // negation toggles this
+	mutable bool _want; // negation toggles this
 	Object* _a; // the first operand
 	Object* _b; // the second operand
 };
 
 // A quantified statement uses either the universal quantifier (for all) or the
 // existential quantifier (there exists). It binds a variable in its body, an
-// open sentence, thereby creating a concrete sentence.
+// open sentence, thereby creating a concrete sentence. The occurrences of the
+// variable in the body are bound by index (see Symbol), so the variable itself
+// only supplies the name and identifier, and quantified statements that differ
+// only in the names of their variables are equal.
 class Quantified : public Sentence {
 public:
 	enum Type { FORALL = 0, EXISTS = 1 };
 
 	// Creates an ordinary quantified statement of the given type with the
-	// supplied variable and the body, which should be an open sentence.
+	// supplied variable and the body, which should be an open sentence. The
+	// free occurrences of the variable in the body become bound.
 	Quantified(Type t, Symbol* var, Sentence* body);
 
 	// Creates a quantified statement using the domain shorthand, which
 	// restricts the values of the variable considered to a particular set.
-	Quantified(Type t, Symbol* var, Set* domain, Sentence* body);
+	Quantified(Type t, Symbol* var, Object* domain, Sentence* body);
 
 	virtual ~Quantified();
 	Quantified* cloneSelf() const;
 	virtual Sentence* clone() const;
-	virtual Value value() const;
-	virtual void negate();
+	virtual Value evaluate(Env& env) const;
+	virtual void fold();
+	virtual void abstract(unsigned int id, unsigned int depth);
+	virtual void substitute(unsigned int depth, const Object& term);
 	virtual std::vector<Decomp> decompose() const;
 	virtual std::vector<Deduct> deduce() const;
 	virtual std::ostream& print(std::ostream& s) const;
+	virtual void encode(Encoder& e) const;
+
+	// Returns the bound variable.
+	const Symbol& var() const { return *_var; }
+
+	// Returns a copy of the body with the variable replaced by the term, whose
+	// symbols must be free. Symbols in the term are never captured by other
+	// quantifiers in the body, and nothing is renamed.
+	SentencePtr instantiate(const Object& term) const;
 
-	// Returns the quantifier type specified by the string, or -1 otherwise.
-	static int getType(const std::string& s);
+	// Returns the quantifier printed for the type.
+	static const char* name(Type t);
+
+protected:
+	virtual bool equalSelf(const Sentence& other) const;
+	virtual std::uint64_t computeHash() const;
+	virtual void pushNegation() const;
+	virtual void buildDecomp(int rule, Sentence*& givenA, Sentence*& goalA,
+		Sentence*& givenB, Sentence*& goalB) const;
+	virtual Sentence* buildConclusion(int rule) const;
 
 private:
-	Type _type; // the quantifier type
+	// Creates a quantified statement whose body already refers to the variable
+	// by index, as in a clone.
+	Quantified(Type t, Symbol* var, Sentence* body, bool);
+
+	mutable Type _type; // the quantifier type
 	Symbol* _var; // the bound variable
 	Sentence* _body; // the quantified open sentence
 };
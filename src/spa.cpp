@@ -1,7 +1,9 @@
 // Copyright 2015 Mitchell Kember. Subject to the MIT License.
 
+#include "batch.hpp"
 #include "parse.hpp"
 #include "prover.hpp"
+#include "sentence.hpp"
 
 #include <readline/readline.h>
 #include <readline/history.h>
@@ -24,7 +26,9 @@ namespace {
 	const char* help = "\n"
 	"help   -  show this help message\n"
 	"quit   -  quit the program\n"
-	"prove  -  set the theorem to prove\n"
+	"prove  -  set the theorem to prove (or the nth loaded one)\n"
+	"load   -  load a file of theorems, one per line\n"
+	"save   -  save the loaded theorems to a binary file\n"
 	"dec    -  decompose the current goal\n"
 	"ded    -  deduce from the current goal\n"
 	"triv   -  prove a trivial goal\n"
@@ -36,6 +40,7 @@ namespace {
 	"tree   -  show the entire proof tree\n\n";
 
 	const char* bad_cmd = "invalid command";
+	const char* bad_num = "no loaded theorem with that number";
 	const char* no_thm = "no theorem loaded";
 }
 
@@ -44,14 +49,59 @@ static void error(const char* s) {
 	std::cerr << "error: " << s << '\n';
 }
 
+// Loads the theorem file at the given path into the library, and reports the
+// diagnostics and a summary of the load.
+static void load(const std::string& path, TheoremFile& lib) {
+	std::string err;
+	if (!lib.load(path.c_str(), 0, err)) {
+		error(err.c_str());
+		return;
+	}
+	lib.printDiagnostics(std::cerr);
+	lib.printSummary(std::cout);
+}
+
+// Saves the library to a binary file at the given path.
+static void save(const std::string& path, const TheoremFile& lib) {
+	std::string err;
+	if (!lib.save(path.c_str(), err)) {
+		error(err.c_str());
+		return;
+	}
+	std::cout << "Saved " << lib._sentences.size() << " sentence(s).\n";
+}
+
+// Sets the theorem to a copy of the nth sentence in the library.
+static void proveLoaded(const std::string& arg, const TheoremFile& lib,
+		TheoremProver& tp) {
+	std::size_t n;
+	try {
+		n = static_cast<std::size_t>(std::stoul(arg));
+	} catch (const std::invalid_argument& e) {
+		(void)e;
+		error(bad_num);
+		return;
+	} catch (const std::out_of_range& e) {
+		(void)e;
+		error(bad_num);
+		return;
+	}
+	if (n == 0 || n > lib._sentences.size()) {
+		error(bad_num);
+		return;
+	}
+	tp.setTheorem(lib._sentences[n - 1].get());
+}
+
 // Performs the appropriate action for the given tokenized user input. Does
 // nothing for empty input. Returns true if the program should quit.
-static bool dispatch(const StrVec& tokens, TheoremProver& tp) {
+static bool dispatch(const TokVec& tokens, TheoremProver& tp,
+		TheoremFile& lib) {
 	auto size = tokens.size();
 	if (size == 0) {
 		return false;
 	}
-	const std::string cmd = tokens[0];
+	const Token cmd = tokens[0];
 	if (size == 1) {
 		if (cmd == "quit" || cmd == "exit") {
 			return true;
@@ -59,6 +109,8 @@ static bool dispatch(const StrVec& tokens, TheoremProver& tp) {
 		TheoremProver::Mode m = tp.mode();
 		if (cmd == "prove") {
 			error("expecting theorem");
+		} else if (cmd == "load" || cmd == "save") {
+			error("expecting file name");
 		} else if (cmd == "help") {
 			std::cout << help;
 		} else if (cmd == "dec" || cmd == "ded" || cmd == "triv"
@@ -102,13 +154,19 @@ static bool dispatch(const StrVec& tokens, TheoremProver& tp) {
 		} else {
 			error(bad_cmd);
 		}
+	} else if (cmd == "load" && size == 2) {
+		load(tokens[1].str(), lib);
+	} else if (cmd == "save" && size == 2) {
+		save(tokens[1].str(), lib);
+	} else if (cmd == "prove" && size == 2) {
+		proveLoaded(tokens[1].str(), lib, tp);
 	} else if (cmd == "prove") {
 		Index i = 1;
-		Sentence* thm = parseSentence(tokens, i);
+		SentencePtr thm = parseSentence(tokens, i);
 		if (thm == nullptr) {
 			error(parseError);
 		} else {
-			tp.setTheorem(thm);
+			tp.setTheorem(thm.get());
 		}
 	} else {
 		error(bad_cmd);
@@ -121,6 +179,7 @@ static bool dispatch(const StrVec& tokens, TheoremProver& tp) {
 int main() {
 	char* line;
 	TheoremProver tp;
+	TheoremFile lib;
 	std::cout << header << '\n';
 	for (;;) {
 		line = readline(prompt);
@@ -130,10 +189,10 @@ int main() {
 			std::cout << '\n';
 			break;
 		}
-		StrVec tokens = tokenize(line);
+		TokVec tokens = tokenizeView(line);
 		if (tokens.size() != 0) {
 			add_history(line);
-			if (dispatch(tokens, tp)) {
+			if (dispatch(tokens, tp, lib)) {
 				break;
 			}
 		}
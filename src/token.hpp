@@ -0,0 +1,41 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <cstring>
+#include <string>
+
+// A token is a view into a span of characters owned by someone else, usually
+// the input line. It never copies or allocates, so the buffer it points into
+// must outlive it.
+class Token {
+public:
+	Token(const char* data, std::size_t size) : _data(data), _size(size) {}
+
+	// Returns a copy of the token's characters as a string.
+	std::string str() const { return std::string(_data, _size); }
+
+	const char* _data; // the first character (not null-terminated)
+	std::size_t _size; // the number of characters
+};
+
+// Compares the characters of a token to a null-terminated string.
+inline bool operator==(const Token& t, const char* s) {
+	return t._size == std::strlen(s) && std::memcmp(t._data, s, t._size) == 0;
+}
+inline bool operator!=(const Token& t, const char* s) {
+	return !(t == s);
+}
+
+// Returns true if the character always forms a token by itself.
+inline bool isPunct(char c) {
+	return c == '(' || c == ')' || c == '{' || c == '}' || c == ',';
+}
+
+// Returns true if the character separates tokens.
+inline bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "arena.hpp"
+
+#include "object.hpp"
+#include "sentence.hpp"
+
+#include "catch.hpp"
+
+#include <sstream>
+#include <utility>
+
+TEST_CASE("the arena bump-allocates aligned memory", "[arena]") {
+	Arena arena;
+	const std::size_t align = alignof(std::max_align_t);
+	char* a = static_cast<char*>(arena.allocate(1));
+	char* b = static_cast<char*>(arena.allocate(3));
+	CHECK(b == a + align);
+	void* big = arena.allocate(1000000);
+	char* c = static_cast<char*>(arena.allocate(1));
+	CHECK(big != nullptr);
+	CHECK(c == b + align);
+	CHECK(arena.bytes() >= 1000000);
+	arena.release();
+	CHECK(arena.bytes() == 0);
+	CHECK(arena.allocate(1) == a);
+}
+
+TEST_CASE("nodes come from the current arena", "[arena]") {
+	Arena arena;
+	Sentence* s;
+	{
+		ArenaScope scope(arena);
+		s = new Relation(Relation::IN, true, new Symbol("x"),
+			new ConcreteSet({new ConcreteNumber(1), new ConcreteNumber(2)}));
+	}
+	std::size_t used = arena.bytes();
+	CHECK(used > 0);
+
+	// Clones made outside the scope are on the heap, and deleting them does
+	// not touch the arena.
+	Sentence* heap = s->clone();
+	CHECK(arena.bytes() == used);
+	std::ostringstream out;
+	out << *heap;
+	CHECK(out.str() == "(in x {1, 2})");
+	delete heap;
+
+	// Deleting an arena node is harmless, and the memory comes back when the
+	// arena is released.
+	delete s;
+	CHECK(arena.bytes() == used);
+	arena.release();
+	CHECK(arena.bytes() == 0);
+}
+
+TEST_CASE("node allocations are counted", "[arena]") {
+	std::size_t before = nodeCount();
+	SentencePtr s(new Relation(Relation::EQ, true,
+		new ConcreteNumber(1), new ConcreteNumber(2)));
+	CHECK(nodeCount() == before + 3);
+
+	// Moving a handle transfers the sentence without copying it.
+	SentencePtr t = std::move(s);
+	CHECK(s == nullptr);
+	CHECK(nodeCount() == before + 3);
+	SentencePtr u(t->clone());
+	CHECK(nodeCount() == before + 6);
+}
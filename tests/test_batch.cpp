@@ -0,0 +1,45 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "batch.hpp"
+
+#include "sentence.hpp"
+
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+TEST_CASE("theorem files load in order with diagnostics", "[batch]") {
+	const char* path = "test_batch_tmp.txt";
+	{
+		std::ofstream out(path);
+		for (int i = 0; i < 1000; ++i) {
+			if (i == 10) {
+				out << "(= 1\n";
+			} else if (i == 20) {
+				out << "   \n";
+			} else {
+				out << "(< " << i << " x)\n";
+			}
+		}
+		out << "(= 0 0) (= 1 1)";
+	}
+	TheoremFile lib;
+	std::string err;
+	REQUIRE(lib.load(path, 4, err));
+	std::remove(path);
+	CHECK(lib._lineCount == 1001);
+	REQUIRE(lib._sentences.size() == 998);
+	REQUIRE(lib._diagnostics.size() == 2);
+	CHECK(lib._diagnostics[0]._line == 11);
+	CHECK(lib._diagnostics[1]._line == 1001);
+	for (std::size_t k = 0; k < lib._sentences.size(); ++k) {
+		std::size_t i = lib._lines[k] - 1;
+		std::ostringstream s;
+		s << *lib._sentences[k];
+		CHECK(s.str() == "(< " + std::to_string(i) + " x)");
+	}
+	CHECK(!lib.load("no/such/file", 1, err));
+	CHECK(lib._sentences.empty());
+}
@@ -0,0 +1,80 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "bitmap.hpp"
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+typedef std::vector<std::uint32_t> Values;
+
+static Bitmap make(const Values& v) {
+	return Bitmap::fromSorted(v.data(), v.size());
+}
+
+static Values values(const Bitmap& b) {
+	Values v;
+	b.values(v);
+	return v;
+}
+
+// Returns a mix of sparse values, a dense block, and a long run, spread across
+// several containers.
+static Values sample(std::uint32_t seed) {
+	Values v;
+	for (std::uint32_t i = 0; i < 2000; ++i) {
+		v.push_back(i * (37 + seed));
+	}
+	for (std::uint32_t i = 0; i < 30000; ++i) {
+		v.push_back(0x20000 + i * 2 + seed % 2);
+	}
+	for (std::uint32_t i = 0; i < 50000; ++i) {
+		v.push_back(0x50000 + seed * 1000 + i);
+	}
+	std::sort(v.begin(), v.end());
+	v.erase(std::unique(v.begin(), v.end()), v.end());
+	return v;
+}
+
+TEST_CASE("bitmaps choose compact containers", "[bitmap]") {
+	Values v = sample(0);
+	Bitmap b = make(v);
+	CHECK(b.size() == v.size());
+	CHECK(values(b) == v);
+	CHECK(b.count(Bitmap::ARRAY) > 0);
+	CHECK(b.count(Bitmap::BITSET) > 0);
+	CHECK(b.count(Bitmap::RUN) > 0);
+	CHECK(b.contains(0x20000));
+	CHECK(!b.contains(0x20001));
+	CHECK(b.contains(0x50000 + 49999));
+	CHECK(!b.contains(0xffffffffu));
+	CHECK(make(Values()).size() == 0);
+}
+
+TEST_CASE("bitmap operations match sorted merges", "[bitmap]") {
+	Values x = sample(1);
+	Values y = sample(4);
+	Bitmap a = make(x);
+	Bitmap b = make(y);
+
+	Values expect;
+	std::set_union(x.begin(), x.end(), y.begin(), y.end(),
+		std::back_inserter(expect));
+	CHECK(values(Bitmap::unite(a, b)) == expect);
+	CHECK(Bitmap::unite(a, b) == make(expect));
+
+	expect.clear();
+	std::set_intersection(x.begin(), x.end(), y.begin(), y.end(),
+		std::back_inserter(expect));
+	CHECK(values(Bitmap::intersect(a, b)) == expect);
+	CHECK(Bitmap::intersect(a, b).subsetOf(a));
+
+	expect.clear();
+	std::set_difference(x.begin(), x.end(), y.begin(), y.end(),
+		std::back_inserter(expect));
+	CHECK(values(Bitmap::subtract(a, b)) == expect);
+	CHECK(Bitmap::subtract(a, a).size() == 0);
+	CHECK(!a.subsetOf(b));
+}
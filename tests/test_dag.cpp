@@ -0,0 +1,96 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "dag.hpp"
+
+#include "parse.hpp"
+#include "sentence.hpp"
+
+#include "catch.hpp"
+
+#include <sstream>
+
+static Sentence* parse(const char* line) {
+	TokVec tokens = tokenizeView(line);
+	Index i = 0;
+	return parseSentence(tokens, i).release();
+}
+
+static std::string str(const Sentence* s) {
+	std::ostringstream out;
+	out << *s;
+	return out.str();
+}
+
+TEST_CASE("repeated subterms are shared in the DAG", "[dag]") {
+	Dag dag;
+	{
+		Sentence* s = parse("(and (= (+ x 1) {x, x}) (= (+ x 1) {x, x}))");
+		REQUIRE(s != nullptr);
+		DagRef r = dag.intern(*s);
+		// x, 1, (+ x 1), {x, x}, the relation, and the conjunction.
+		CHECK(dag.size() == 6);
+		CHECK(r.size() == 2);
+		CHECK(r[0] == r[1]);
+		CHECK(r[0][0] != r[0][1]);
+		CHECK(r->_hash == dag.intern(*s)->_hash);
+		CHECK(dag.intern(*s) == r);
+
+		Sentence* e = dag.expand(r);
+		REQUIRE(e != nullptr);
+		CHECK(str(e) == str(s));
+		// Expanding keeps the identifiers, so interning again finds the root.
+		CHECK(dag.intern(*e) == r);
+		delete e;
+
+		// Symbols with the same name from different parses are different.
+		Sentence* t = parse("(and (= (+ x 1) {x, x}) (= (+ x 1) {x, x}))");
+		REQUIRE(t != nullptr);
+		CHECK(dag.intern(*t) != r);
+		delete t;
+		delete s;
+
+		// Copies are references to the same node.
+		DagRef copy = r;
+		CHECK(copy == r);
+		CHECK(copy->_refs >= 2);
+	}
+	CHECK(dag.size() == 0);
+}
+
+TEST_CASE("new DAG nodes can be built from existing ones", "[dag]") {
+	Dag dag;
+	Sentence* s = parse("(< 1 2)");
+	REQUIRE(s != nullptr);
+	DagRef lt = dag.intern(*s);
+	delete s;
+	DagRef ge = dag.make(FLAT_RELATION, Relation::LT, false, 0, {lt[0], lt[1]});
+	CHECK(ge != lt);
+	CHECK(ge[0] == lt[0]);
+	CHECK(dag.size() == 4);
+	Sentence* e = dag.expand(ge);
+	REQUIRE(e != nullptr);
+	CHECK(str(e) == "(>= 1 2)");
+	delete e;
+	CHECK(dag.make(FLAT_RELATION, Relation::LT, true, 0, {ge[0], ge[1]}) == lt);
+}
+
+TEST_CASE("alpha-equivalent sentences share DAG nodes", "[dag]") {
+	Dag dag;
+	Sentence* s = parse("(forall x (exists y (< x (+ y 1))))");
+	Sentence* t = parse("(forall a (exists b (< a (+ b 1))))");
+	Sentence* u = parse("(forall a (exists b (< b (+ a 1))))");
+	REQUIRE(s->equal(*t));
+	DagRef r = dag.intern(*s);
+	CHECK(dag.intern(*t) == r);
+	CHECK(dag.intern(*u) != r);
+
+	// Expanding uses the names of the sentence interned first.
+	Sentence* e = dag.expand(r);
+	REQUIRE(e != nullptr);
+	CHECK(str(e) == str(s));
+	CHECK(e->equal(*t));
+	delete e;
+	delete s;
+	delete t;
+	delete u;
+}
@@ -0,0 +1,123 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "encode.hpp"
+
+#include "batch.hpp"
+#include "parse.hpp"
+#include "sentence.hpp"
+
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+	const char* samples[] = {
+		"(= 1 -2147483648)",
+		"(forall x in NN (!= x -1))",
+		"(not (and (= 1 1) (sub {x, 2, {}, null} ZZ)))",
+		"(exists y (or (in (+ y (* 2 y)) (union SS (diff {1} NN))) (s= {} y)))",
+		"(iff (div 3 n) (=> (< n 0) (<= n' n_2)))",
+		"(< 123456789012345678901234567890 (+ -9223372036854775808 4294967296))",
+		"(forall n in {..., -5, 0, ..., 1000000, 2000000000000, ...} (< 0 n))"
+	};
+}
+
+static Sentence* parse(const char* line) {
+	TokVec tokens = tokenizeView(line);
+	Index i = 0;
+	return parseSentence(tokens, i).release();
+}
+
+static std::string str(const Sentence* s) {
+	std::ostringstream out;
+	out << *s;
+	return out.str();
+}
+
+TEST_CASE("sentences survive a round trip through flat code", "[encode]") {
+	Encoder e;
+	std::vector<std::string> expected;
+	for (const char* line: samples) {
+		Sentence* s = parse(line);
+		REQUIRE(s != nullptr);
+		e.add(*s);
+		expected.push_back(str(s));
+		delete s;
+	}
+	const FlatCode& code = e.code();
+	REQUIRE(code.size() == expected.size());
+	CHECK(code.begin(0)[0]._tag == FLAT_NUMBER);
+	CHECK(code.end(0)[-1]._tag == FLAT_RELATION);
+	for (std::size_t i = 0; i < code.size(); ++i) {
+		Sentence* s = code.decode(i);
+		REQUIRE(s != nullptr);
+		CHECK(str(s) == expected[i]);
+		delete s;
+	}
+
+	// Dropping the root leaves two operands, which is not one sentence.
+	CHECK(decodeFlat(code.begin(0), code.end(0) - 1, code._names) == nullptr);
+	CHECK(decodeFlat(code.begin(1), code.end(1) - 1, code._names) == nullptr);
+}
+
+TEST_CASE("flat files are written and mapped back", "[encode]") {
+	const char* path = "test_encode_tmp.bin";
+	Encoder e;
+	for (const char* line: samples) {
+		Sentence* s = parse(line);
+		REQUIRE(s != nullptr);
+		e.add(*s);
+		delete s;
+	}
+	std::string err;
+	REQUIRE(e.write(path, err));
+	FlatFile file;
+	REQUIRE(file.open(path, err));
+	REQUIRE(file.size() == e.code().size());
+	for (std::size_t i = 0; i < file.size(); ++i) {
+		auto length = e.code().end(i) - e.code().begin(i);
+		REQUIRE(length == file.end(i) - file.begin(i));
+		Sentence* a = file.decode(i);
+		Sentence* b = e.code().decode(i);
+		REQUIRE(a != nullptr);
+		REQUIRE(b != nullptr);
+		CHECK(str(a) == str(b));
+		delete a;
+		delete b;
+	}
+	file.close();
+
+	// A theorem file saved in binary loads back the same sentences.
+	TheoremFile lib;
+	REQUIRE(lib.load(path, 1, err));
+	CHECK(lib._sentences.size() == e.code().size());
+	REQUIRE(lib.save(path, err));
+	TheoremFile copy;
+	REQUIRE(copy.load(path, 1, err));
+	REQUIRE(copy._sentences.size() == lib._sentences.size());
+	for (std::size_t i = 0; i < lib._sentences.size(); ++i) {
+		CHECK(str(copy._sentences[i].get()) == str(lib._sentences[i].get()));
+	}
+
+	// Text files and truncated files are rejected.
+	{
+		std::ofstream out(path);
+		out << "(= 1 1)\n";
+	}
+	CHECK(!file.open(path, err));
+	CHECK(err == "not a binary sentence file");
+	REQUIRE(e.write(path, err));
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::string data((std::istreambuf_iterator<char>(in)),
+			std::istreambuf_iterator<char>());
+		std::ofstream out(path, std::ios::binary);
+		out.write(data.data(), static_cast<std::streamsize>(data.size() - 1));
+	}
+	CHECK(!file.open(path, err));
+	CHECK(err == "binary file is truncated");
+	std::remove(path);
+}
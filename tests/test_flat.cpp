@@ -0,0 +1,126 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "flat.hpp"
+
+#include "parse.hpp"
+
+#include "catch.hpp"
+
+#include <sstream>
+
+namespace {
+	const char* samples[] = {
+		"(= 1 -2147483648)",
+		"(forall x in NN (!= x -1))",
+		"(not (and (= 1 1) (sub {x, 2, {}, null} ZZ)))",
+		"(exists y (or (in (+ y (* 2 y)) (union SS (diff {1} NN))) (s= {} y)))",
+		"(iff (div 3 n) (=> (< n 0) (<= n' n_2)))",
+		"(< 123456789012345678901234567890 (+ -9223372036854775808 4294967296))",
+		"(forall n in {..., -5, 0, ..., 1000000, 2000000000000, ...} (< 0 n))",
+		"(in {-9223372036854775808, 5, 10000000000000000000000} {{}, {x, y}})"
+	};
+}
+
+static Sentence* parse(const char* line) {
+	TokVec tokens = tokenizeView(line);
+	Index i = 0;
+	return parseSentence(tokens, i).release();
+}
+
+TEST_CASE("flat kernels agree with the sentences", "[flat]") {
+	Encoder e;
+	std::vector<Sentence*> sentences;
+	for (const char* line: samples) {
+		Sentence* s = parse(line);
+		REQUIRE(s != nullptr);
+		e.add(*s);
+		sentences.push_back(s);
+	}
+	const FlatCode& code = e.code();
+	for (std::size_t i = 0; i < code.size(); ++i) {
+		std::ostringstream tree, flat;
+		tree << *sentences[i];
+		printFlat(flat, code.begin(i), code.end(i), code._names);
+		CHECK(flat.str() == tree.str());
+		std::uint64_t h = hashFlat(code.begin(i), code.end(i), &code._ids);
+		CHECK(h == sentences[i]->hash());
+		CHECK(equalFlat(code.begin(i), code.end(i),
+			code.begin(i), code.end(i), code._names));
+		if (i > 0) {
+			CHECK(!equalFlat(code.begin(i), code.end(i),
+				code.begin(i - 1), code.end(i - 1), code._names));
+		}
+		delete sentences[i];
+	}
+}
+
+TEST_CASE("flat equality ignores the order of set elements", "[flat]") {
+	Sentence* s = parse("(in 0 {{x}, {y}})");
+	REQUIRE(s != nullptr);
+	Encoder e;
+	e.add(*s);
+	const FlatCode& code = e.code();
+	std::ptrdiff_t n = code.end(0) - code.begin(0);
+	REQUIRE(n == 7);
+
+	// Swapping the symbols lists the same set as {{y}, {x}}.
+	std::vector<FlatNode> swapped(code.begin(0), code.end(0));
+	REQUIRE(swapped[1]._tag == FLAT_SYMBOL);
+	REQUIRE(swapped[3]._tag == FLAT_SYMBOL);
+	std::swap(swapped[1], swapped[3]);
+	const FlatNode* begin = swapped.data();
+	const FlatNode* end = begin + swapped.size();
+	CHECK(equalFlat(code.begin(0), code.end(0), begin, end, code._names));
+
+	// Now it is {{x}, {x}}.
+	swapped[1] = swapped[3];
+	CHECK(!equalFlat(code.begin(0), code.end(0), begin, end, code._names));
+	delete s;
+}
+
+TEST_CASE("ground sentences evaluate in flat form", "[flat]") {
+	const char* lines[] = {
+		"(and (< (+ 1 2) 4) (not (div 0 5)))",
+		"(iff (= (* 4611686018427387904 4) 18446744073709551616) (<= 2 1))",
+		"(=> (div -1 7) (or (= 1 2) (div 3 9)))"
+	};
+	Encoder e;
+	for (const char* line: lines) {
+		Sentence* s = parse(line);
+		REQUIRE(s != nullptr);
+		e.add(*s);
+		Sentence::Value v;
+		const FlatCode& code = e.code();
+		std::size_t i = code.size() - 1;
+		REQUIRE(evaluateFlat(code.begin(i), code.end(i), v));
+		CHECK(v == s->value());
+		delete s;
+	}
+
+	// Sentences with symbols or sets are left to the tree.
+	Sentence* s = parse("(forall x in {1, 2} (< 0 x))");
+	e.add(*s);
+	const FlatCode& code = e.code();
+	std::size_t i = code.size() - 1;
+	Sentence::Value v;
+	CHECK(!evaluateFlat(code.begin(i), code.end(i), v));
+	delete s;
+}
+
+TEST_CASE("flat equality ignores the names of bound variables", "[flat]") {
+	Sentence* s = parse("(forall x (exists y (< x y)))");
+	Sentence* t = parse("(forall a (exists b (< a b)))");
+	Sentence* u = parse("(forall a (exists b (< b a)))");
+	Encoder e;
+	e.add(*s);
+	e.add(*t);
+	e.add(*u);
+	const FlatCode& code = e.code();
+	CHECK(equalFlat(code.begin(0), code.end(0),
+		code.begin(1), code.end(1), code._names));
+	CHECK(!equalFlat(code.begin(0), code.end(0),
+		code.begin(2), code.end(2), code._names));
+	delete s;
+	delete t;
+	delete u;
+}
@@ -0,0 +1,82 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "integer.hpp"
+
+#include "catch.hpp"
+
+#include <cstring>
+#include <limits>
+
+static Integer parse(const char* str) {
+	Integer x;
+	REQUIRE(Integer::parse(str, str + std::strlen(str), x));
+	return x;
+}
+
+TEST_CASE("small integers stay inline", "[integer]") {
+	Integer a(40);
+	Integer b = a + 2;
+	CHECK(b.isSmall());
+	CHECK(b.small() == 42);
+	CHECK((a * -3).small() == -120);
+	CHECK((a - 50).small() == -10);
+	CHECK(Integer(std::numeric_limits<long long>::max()).isSmall());
+	CHECK(parse("-9223372036854775808").isSmall());
+	CHECK(!parse("9223372036854775808").isSmall());
+	Integer x;
+	CHECK(!Integer::parse("12a", "12a" + 3, x));
+	CHECK(!Integer::parse("-", "-" + 1, x));
+}
+
+TEST_CASE("integers spill to limbs on overflow", "[integer]") {
+	const long long max = std::numeric_limits<long long>::max();
+	Integer big = Integer(max) + 1;
+	CHECK(!big.isSmall());
+	CHECK(big.str() == "9223372036854775808");
+	CHECK((big - 1).isSmall());
+	CHECK((big - 1).small() == max);
+	CHECK((-big).isSmall());
+
+	Integer p = parse("123456789012345678901234567890");
+	CHECK(p.str() == "123456789012345678901234567890");
+	CHECK((p * p).str()
+		== "15241578753238836750495351562536198787501905199875019052100");
+	CHECK((p * -p + p * p) == 0);
+	CHECK((-p).str() == "-123456789012345678901234567890");
+	CHECK((p - parse("123456789012345678901234567891")).small() == -1);
+	CHECK(parse("1000000000000000000000000000000").str()
+		== "1000000000000000000000000000000");
+}
+
+TEST_CASE("remainders have the sign of the dividend", "[integer]") {
+	const long long min = std::numeric_limits<long long>::min();
+	CHECK((Integer(17) % 5).small() == 2);
+	CHECK((Integer(-17) % 5).small() == -2);
+	CHECK((Integer(17) % -5).small() == 2);
+	CHECK((Integer(min) % -1).small() == 0);
+
+	Integer p = parse("123456789012345678901234567890");
+	CHECK((p % 11).small() == 7);
+	CHECK((-p % 11).small() == -7);
+	CHECK((p % 1000000007).small() == 197434842);
+	CHECK((p % std::numeric_limits<long long>::max()).small()
+		== 4860475750367701695);
+	CHECK((p % parse("99999999999999999999")).str() == "12345678902469135780");
+	CHECK((p % -p) == 0);
+	CHECK((Integer(5) % p).small() == 5);
+}
+
+TEST_CASE("integers compare and hash by value", "[integer]") {
+	Integer p = parse("-123456789012345678901234567890");
+	Integer q = parse("99999999999999999999");
+	CHECK(p < q);
+	CHECK(p < 0);
+	CHECK(q > std::numeric_limits<long long>::max());
+	CHECK(Integer(5) <= 5);
+	Integer r = q * 2 - q;
+	CHECK(r == q);
+	CHECK(r.hash() == q.hash());
+	CHECK(Integer(7).hash() == (Integer(3) + 4).hash());
+	CHECK(Integer::fromMagnitude(q.magnitude().data(), q.magnitude().size(),
+		false) == q);
+}
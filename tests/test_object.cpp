@@ -4,4 +4,229 @@
 
 #include "catch.hpp"
 
+#include <sstream>
 
+TEST_CASE("names are interned", "[object]") {
+	unsigned int a = internName("alpha", 5);
+	CHECK(internName("alphabet", 5) == a);
+	CHECK(internName("beta", 4) != a);
+	CHECK(nameString(a) == "alpha");
+}
+
+TEST_CASE("symbol maps bind names to identifiers", "[object]") {
+	SymMap map;
+	CHECK(map.find(3) == SymMap::NONE);
+	map.bind(3, 7);
+	map.bind(1000, 8);
+	CHECK(map.find(3) == 7);
+	CHECK(map.find(1000) == 8);
+	map.clear();
+	CHECK(map.find(3) == SymMap::NONE);
+	CHECK(map.find(1000) == SymMap::NONE);
+}
+
+TEST_CASE("objects compare and hash structurally", "[object]") {
+	Symbol x("x");
+	Object* a = new CompoundNumber(CompoundNumber::ADD,
+		x.cloneSelf(), new ConcreteNumber(1));
+	Object* b = a->clone();
+	Object* c = new CompoundNumber(CompoundNumber::ADD,
+		new Symbol("x"), new ConcreteNumber(1));
+	CHECK(a->equal(*b));
+	CHECK(a->hash() == b->hash());
+	CHECK(!a->equal(*c));
+	CHECK(!a->equal(x));
+	Object* d = x.clone();
+	CHECK(x.equal(*d));
+	delete a;
+	delete b;
+	delete c;
+	delete d;
+
+	ConcreteSet s({new ConcreteNumber(1), new SpecialSet(SpecialSet::EMPTY)});
+	Object* t = s.clone();
+	CHECK(s.equal(*t));
+	CHECK(!s.equal(ConcreteSet({new ConcreteNumber(1)})));
+	delete t;
+}
+
+TEST_CASE("objects are tagged with their kinds", "[object]") {
+	ConcreteNumber n(1);
+	Symbol x("x");
+	SpecialSet e(SpecialSet::EMPTY);
+	CHECK(n.kind() == Object::CONCRETE_NUMBER);
+	CHECK(n.isNumber());
+	CHECK(!n.isSet());
+	CHECK(x.isNumber());
+	CHECK(x.isSet());
+	CHECK(!e.isNumber());
+	CHECK(e.isSet());
+
+	const Object* o = &e;
+	CHECK(objectCast<SpecialSet>(o) == &e);
+	CHECK(objectCast<Set>(o) == &e);
+	CHECK(objectCast<Number>(o) == nullptr);
+	CHECK(objectCast<Symbol>(o) == nullptr);
+	o = &x;
+	CHECK(objectCast<Symbol>(o) == &x);
+	CHECK(objectCast<Set>(o) == nullptr);
+	CHECK(objectCast<ConcreteNumber>(static_cast<Object*>(nullptr)) == nullptr);
+}
+
+TEST_CASE("ground numbers evaluate and fold", "[object]") {
+	Object* n = new CompoundNumber(CompoundNumber::MUL,
+		new CompoundNumber(CompoundNumber::SUB,
+			new ConcreteNumber(Integer(1) - 4), new ConcreteNumber(5)),
+		new ConcreteNumber(4611686018427387904));
+	Integer x;
+	REQUIRE(n->evaluate(x, Env()));
+	CHECK(x.str() == "-36893488147419103232");
+	foldInto(n);
+	CHECK(objectCast<ConcreteNumber>(n)->value() == x);
+	delete n;
+
+	Object* o = new CompoundNumber(CompoundNumber::ADD, new Symbol("y"),
+		new CompoundNumber(CompoundNumber::ADD,
+			new ConcreteNumber(1), new ConcreteNumber(1)));
+	CHECK(!o->evaluate(x, Env()));
+	foldInto(o);
+	std::ostringstream out;
+	out << *o;
+	CHECK(out.str() == "(+ y 2)");
+	delete o;
+}
+
+TEST_CASE("concrete sets are canonical", "[object]") {
+	Symbol x("x");
+	ConcreteSet a({new ConcreteNumber(3), x.cloneSelf(), new ConcreteNumber(-1),
+		new ConcreteNumber(3), x.cloneSelf(), new SpecialSet(SpecialSet::EMPTY)});
+	std::ostringstream out;
+	out << a;
+	CHECK(out.str() == "{-1, 3, x, null}");
+	CHECK(a.size() == 4);
+	CHECK(a.contains(3));
+	CHECK(!a.contains(2));
+	CHECK(a.contains(x));
+	CHECK(a.contains(SpecialSet(SpecialSet::EMPTY)));
+	CHECK(!a.contains(Symbol("x")));
+
+	ConcreteSet b({new SpecialSet(SpecialSet::EMPTY), new ConcreteNumber(3),
+		x.cloneSelf(), new ConcreteNumber(-1)});
+	CHECK(a.equal(b));
+	CHECK(a.hash() == b.hash());
+	ConcreteSet c({x.cloneSelf(), new ConcreteNumber(3)});
+	CHECK(c.subsetOf(a));
+	CHECK(!a.subsetOf(c));
+
+	// Folding can turn an element into a duplicate of another.
+	Set* d = new ConcreteSet({new ConcreteNumber(2), new CompoundNumber(
+		CompoundNumber::ADD, new ConcreteNumber(1), new ConcreteNumber(1))});
+	CHECK(d->fold() == nullptr);
+	out.str("");
+	out << *d;
+	CHECK(out.str() == "{2}");
+	delete d;
+}
+
+TEST_CASE("large concrete sets use bitmaps", "[object]") {
+	std::vector<Object*> evens, threes;
+	for (int i = 0; i < 10000; ++i) {
+		evens.push_back(new ConcreteNumber(2 * i));
+		threes.push_back(new ConcreteNumber(3 * i));
+	}
+	ConcreteSet a(evens);
+	ConcreteSet b(threes);
+	REQUIRE(a.usesBitmap());
+	CHECK(a.size() == 10000);
+	CHECK(a.contains(19998));
+	CHECK(!a.contains(19999));
+	CHECK(!a.contains(-(1LL << 40)));
+
+	ConcreteSet* u = a.unite(b);
+	CHECK(u->size() == 10000 + 10000 - 3334);
+	ConcreteSet* i = a.intersect(b);
+	CHECK(i->size() == 3334);
+	CHECK(!i->usesBitmap());
+	CHECK(i->subsetOf(a));
+	CHECK(i->subsetOf(*u));
+	ConcreteSet* d = a.subtract(b);
+	CHECK(d->size() == 10000 - 3334);
+	CHECK(!d->contains(6));
+	CHECK(d->contains(4));
+
+	// A set built directly has the same form as one computed by operations.
+	std::vector<Object*> multiples;
+	for (int k = 0; k < 10000; k += 3) {
+		multiples.push_back(new ConcreteNumber(2 * k));
+	}
+	ConcreteSet m(multiples);
+	CHECK(m.equal(*i));
+	CHECK(m.hash() == i->hash());
+	delete u;
+	delete i;
+	delete d;
+}
+
+TEST_CASE("compound sets of concrete sets fold", "[object]") {
+	Object* s = new CompoundSet(CompoundSet::DIFF,
+		new ConcreteSet({new ConcreteNumber(1), new ConcreteNumber(2)}),
+		new ConcreteSet({new ConcreteNumber(2), new ConcreteNumber(1LL << 40)}));
+	foldInto(s);
+	std::ostringstream out;
+	out << *s;
+	CHECK(out.str() == "{1}");
+	delete s;
+
+	// With a symbol, x might be 1, so the intersection can't be evaluated.
+	s = new CompoundSet(CompoundSet::INTERSECT,
+		new ConcreteSet({new Symbol("x")}),
+		new ConcreteSet({new ConcreteNumber(1)}));
+	foldInto(s);
+	out.str("");
+	out << *s;
+	CHECK(out.str() == "(intersect {x} {1})");
+	delete s;
+}
+
+TEST_CASE("range sets are unions of intervals", "[object]") {
+	typedef RangeSet::Interval I;
+	RangeSet a({I(1, 10), I(20, 30), I(11, 12), I(40, 39)});
+	REQUIRE(a.intervals().size() == 2);
+	CHECK(a.intervals()[0] == I(1, 12));
+	CHECK(a.contains(1));
+	CHECK(a.contains(25));
+	CHECK(!a.contains(15));
+	CHECK(!a.contains(ConcreteNumber(Integer(1) * (1LL << 62) * 4)));
+	CHECK(a.bounded());
+
+	RangeSet naturals(0, RangeSet::MAX);
+	CHECK(!naturals.bounded());
+	CHECK(naturals.contains(RangeSet::MAX));
+	CHECK(a.subsetOf(naturals));
+	CHECK(!naturals.subsetOf(a));
+
+	RangeSet* u = a.unite(RangeSet(13, 19));
+	CHECK(u->equal(RangeSet(1, 30)));
+	RangeSet* i = naturals.intersect(RangeSet(RangeSet::MIN, 5));
+	CHECK(i->equal(RangeSet(0, 5)));
+	RangeSet* d = RangeSet(RangeSet::MIN, RangeSet::MAX).subtract(a);
+	std::ostringstream out;
+	out << *d;
+	CHECK(out.str() == "{..., 0, 13, ..., 19, 31, ...}");
+	delete u;
+	delete i;
+	delete d;
+
+	// Range sets fold with concrete sets of integers, and with ZZ.
+	Object* s = new CompoundSet(CompoundSet::DIFF, new RangeSet(1, 1000000),
+		new ConcreteSet({new ConcreteNumber(5), new ConcreteNumber(6)}));
+	foldInto(s);
+	out.str("");
+	out << *s;
+	CHECK(out.str() == "{1, ..., 4, 7, ..., 1000000}");
+	delete s;
+	s = new CompoundSet(CompoundSet::INTERSECT, new RangeSet(1, 5),
+		new SpecialSet(SpecialSet::NATURALS));
+	CHECK(s->fold() == nullptr);
+	delete s;
+}
@@ -0,0 +1,235 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "parse.hpp"
+
+#include "catch.hpp"
+
+#include <sstream>
+#include <thread>
+
+// Parses the line and prints the resulting sentence, or returns the error.
+static std::string roundTrip(const char* line) {
+	TokVec tokens = tokenizeView(line);
+	Index i = 0;
+	SentencePtr s = parseSentence(tokens, i);
+	if (s == nullptr) {
+		return parseError;
+	}
+	std::ostringstream out;
+	out << *s;
+	return out.str();
+}
+
+TEST_CASE("tokenizeView splits like tokenize", "[parse]") {
+	char line[] = " (in x\t{1,-2}) ";
+	StrVec strs = tokenize(line);
+	TokVec views = tokenizeView(line);
+	REQUIRE(strs.size() == views.size());
+	for (Index i = 0; i < views.size(); ++i) {
+		CHECK(views[i].str() == strs[i]);
+	}
+	CHECK(views[1]._data == line + 2);
+}
+
+TEST_CASE("sentences parse from token views", "[parse]") {
+	CHECK(roundTrip("(forall x in NN (!= x -1))")
+		== "(forall x (=> (in x NN) (!= x -1)))");
+	CHECK(roundTrip("(not (and (= 1 1) (sub {x, 2} ZZ)))")
+		== "(or (!= 1 1) (supe {2, x} ZZ))");
+	CHECK(roundTrip("(= 99999999999 1)") == "(= 99999999999 1)");
+	CHECK(roundTrip("(= 1 1") == "unexpected end of input");
+}
+
+TEST_CASE("the lexer streams tokens from a buffer", "[parse]") {
+	const char text[] = "(and (not (= 1 2)) (in x {x}))  trailing";
+	Lexer lex(text, text + sizeof text - 1);
+	SentencePtr s = parseSentence(lex);
+	REQUIRE(s != nullptr);
+	std::ostringstream out;
+	out << *s;
+	CHECK(out.str() == "(and (!= 1 2) (in x {x}))");
+	CHECK(lex.consumed() == 18);
+	REQUIRE(!lex.done());
+	CHECK(lex.next() == "trailing");
+	CHECK(lex.done());
+}
+
+TEST_CASE("every keyword round-trips", "[parse]") {
+	const char* relations[] = {
+		"=", "!=", "<", ">=", "<=", ">", "s=", "s!=",
+		"sub", "supe", "sube", "sup", "in", "notin", "div", "notdiv"
+	};
+	for (const char* rel: relations) {
+		std::string line = std::string("(") + rel + " a b)";
+		CHECK(roundTrip(line.c_str()) == line);
+	}
+	CHECK(roundTrip("(iff (or (= (+ 1 (- 2 (* 3 4))) 0) (in 1 null)) "
+			"(=> (exists a (sub (union ZZ (intersect NN (diff SS {}))) a)) "
+			"(forall b (= b b))))")
+		== "(iff (or (= (+ 1 (- 2 (* 3 4))) 0) (in 1 null)) "
+			"(=> (exists a (sub (union ZZ (intersect NN (diff SS {}))) a)) "
+			"(forall b (= b b))))");
+	CHECK(roundTrip("(nand (= 1 1) (= 1 1))") == "invalid input");
+}
+
+TEST_CASE("integer literals are told apart from symbols", "[parse]") {
+	CHECK(roundTrip("(= 2147483647 -2147483648)")
+		== "(= 2147483647 -2147483648)");
+	CHECK(roundTrip("(= +7 -0)") == "(= 7 0)");
+	CHECK(roundTrip("(= 2147483648 -2147483649)")
+		== "(= 2147483648 -2147483649)");
+	CHECK(roundTrip("(= -9223372036854775808 +00000000000000000000000000012)")
+		== "(= -9223372036854775808 12)");
+	CHECK(roundTrip("(= 123456789012345678901234567890 1)")
+		== "(= 123456789012345678901234567890 1)");
+	CHECK(roundTrip("(= 1234567890123456789012345678901x 1)")
+		== "invalid symbol character");
+	CHECK(roundTrip("(= 99999999999x 1)") == "invalid symbol character");
+	CHECK(roundTrip("(= 1a 1)") == "invalid symbol character");
+	CHECK(roundTrip("(= -a 1)") == "invalid symbol character");
+}
+
+TEST_CASE("parse results report the error position", "[parse]") {
+	Parser parser;
+	Lexer bad("(and (= 1 1) (= 1 {2 3}))");
+	ParseResult r = parser.parse(bad);
+	CHECK(r._sentence == nullptr);
+	CHECK(std::string(r._error) == "expected comma in set");
+	CHECK(r._position == 12);
+	Lexer good("(= x x)");
+	r = parser.parse(good);
+	REQUIRE(r._sentence != nullptr);
+	CHECK(r._error == nullptr);
+	Lexer eoi("(in x");
+	r = parser.parse(eoi);
+	CHECK(std::string(r._error) == "unexpected end of input");
+	CHECK(r._position == 3);
+}
+
+TEST_CASE("parsers can fold ground arithmetic", "[parse]") {
+	Parser folding(true);
+	Lexer lex("(= (* (+ 1 2) (- x (* 3 3))) {(+ 4000000000 4000000000), x})");
+	ParseResult r = folding.parse(lex);
+	REQUIRE(r._sentence != nullptr);
+	std::ostringstream out;
+	out << *r._sentence;
+	CHECK(out.str() == "(= (* 3 (- x 9)) {8000000000, x})");
+	Lexer sets("(in 2 (union {1, (+ 1 1)} (diff {3, 4} {4})))");
+	r = folding.parse(sets);
+	REQUIRE(r._sentence != nullptr);
+	out.str("");
+	out << *r._sentence;
+	CHECK(out.str() == "(in 2 {1, 2, 3})");
+}
+
+TEST_CASE("ellipses in set literals make ranges", "[parse]") {
+	const char* cases[][2] = {
+		{"(in x {1, ..., 1000000})", "(in x {1, ..., 1000000})"},
+		{"(in x {0, ...})", "(in x {0, ...})"},
+		{"(in x {..., -1, 1, ...})", "(in x {..., -1, 1, ...})"},
+		{"(in x {1, ..., 5, 3, ..., 9, 11})", "(in x {1, ..., 9, 11, ..., 11})"},
+		{"(in x {...})", "(in x {...})"},
+		{"(in x {5, ..., 1})", "(in x {})"}
+	};
+	for (auto& c: cases) {
+		Lexer lex(c[0]);
+		SentencePtr s = parseSentence(lex);
+		REQUIRE(s != nullptr);
+		std::ostringstream out;
+		out << *s;
+		CHECK(out.str() == c[1]);
+	}
+	Parser parser;
+	const char* bad[] = {
+		"(in x {1, ..., ...})", "(in x {1, ..., 5, ..., 9})",
+		"(in x {x, ..., 5})", "(in x {1, ..., 9223372036854775807})"
+	};
+	for (const char* line: bad) {
+		Lexer lex(line);
+		ParseResult r = parser.parse(lex);
+		CHECK(r._sentence == nullptr);
+		CHECK(std::string(r._error) == "expected integer bounds around '...'");
+	}
+}
+
+TEST_CASE("parsers can run on several threads", "[parse]") {
+	const int n = 4;
+	int failures[n] = {};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < n; ++t) {
+		threads.emplace_back([t, &failures] {
+			Parser parser;
+			for (int k = 0; k < 500; ++k) {
+				Lexer lex("(forall x in ZZ (exists y (< x (+ y 1))))");
+				ParseResult r = parser.parse(lex);
+				if (r._sentence == nullptr) {
+					failures[t]++;
+				}
+			}
+		});
+	}
+	for (std::thread& th: threads) {
+		th.join();
+	}
+	for (int t = 0; t < n; ++t) {
+		CHECK(failures[t] == 0);
+	}
+}
+
+// Returns a sentence of the given nesting depth, made of a chain of ands or a
+// chain of additions.
+static std::string deepSentence(std::size_t depth, bool numbers) {
+	std::string line;
+	if (numbers) {
+		line += "(= ";
+		for (std::size_t k = 1; k < depth; ++k) {
+			line += "(+ 1 ";
+		}
+		line += "x";
+		line += std::string(depth - 1, ')');
+		line += " 0)";
+	} else {
+		for (std::size_t k = 1; k < depth; ++k) {
+			line += "(and (= 1 1) ";
+		}
+		line += "(< 1 2)";
+		line += std::string(depth - 1, ')');
+	}
+	return line;
+}
+
+TEST_CASE("deep nesting does not use the call stack", "[parse]") {
+	Parser parser;
+	for (int numbers = 0; numbers < 2; ++numbers) {
+		std::string line = deepSentence(parse_depth_limit, numbers != 0);
+		for (int pass = 0; pass < 2; ++pass) {
+			Lexer lex(line.c_str());
+			ParseResult r = parser.parse(lex);
+			REQUIRE(r._sentence != nullptr);
+			std::ostringstream out;
+			out << *r._sentence;
+			CHECK(out.str() == line);
+		}
+		line.pop_back();
+		Lexer lex(line.c_str());
+		ParseResult r = parser.parse(lex);
+		CHECK(r._sentence == nullptr);
+		CHECK(std::string(r._error) == "unexpected end of input");
+
+		// One more level is rejected instead of overflowing later.
+		line = deepSentence(parse_depth_limit + 1, numbers != 0);
+		Lexer deeper(line.c_str());
+		r = parser.parse(deeper);
+		CHECK(r._sentence == nullptr);
+		CHECK(std::string(r._error) == "expression is nested too deeply");
+	}
+}
+
+TEST_CASE("symbols can have long names", "[parse]") {
+	CHECK(roundTrip("(forall x_1 (exists x' (< x_1 (+ x' delta0))))")
+		== "(forall x_1 (exists x' (< x_1 (+ x' delta0))))");
+	CHECK(roundTrip("(= x-y 1)") == "invalid symbol character");
+	CHECK(roundTrip("(forall in (= in in))")
+		== "keywords cannot be used as symbols");
+	CHECK(roundTrip("(= and 1)") == "keywords cannot be used as symbols");
+}
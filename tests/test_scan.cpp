@@ -0,0 +1,42 @@
+// Copyright 2015 Mitchell Kember. Subject to the MIT License.
+
+#include "scan.hpp"
+
+#include "parse.hpp"
+
+#include "catch.hpp"
+
+#include <string>
+
+TEST_CASE("every scan implementation matches the lexer", "[scan]") {
+	// Long enough to cross several blocks, with tokens straddling the block
+	// boundaries at various offsets.
+	std::string text;
+	for (int k = 0; k < 50; ++k) {
+		text += "(forall x" + std::to_string(k) + " in {1,  -22,"
+			+ std::string(static_cast<std::size_t>(k % 7), ' ')
+			+ "abc}\t(=> (< a\r\nb) (sube {} ZZ)))";
+	}
+	text += "tail";
+	const ScanImpl impls[] = {SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2};
+	for (ScanImpl impl: impls) {
+		if (!scanImplSupported(impl)) {
+			continue;
+		}
+		for (std::size_t len: {text.size(), std::size_t(64), std::size_t(0)}) {
+			TokVec tokens;
+			scanTokens(impl, text.data(), text.data() + len, tokens);
+			TokVec want;
+			Lexer sub(text.data(), text.data() + len);
+			while (!sub.done()) {
+				want.push_back(sub.next());
+			}
+			REQUIRE(tokens.size() == want.size());
+			for (std::size_t i = 0; i < tokens.size(); ++i) {
+				CHECK(tokens[i]._data == want[i]._data);
+				CHECK(tokens[i]._size == want[i]._size);
+			}
+		}
+	}
+	CHECK(scanImplSupported(bestScanImpl()));
+}
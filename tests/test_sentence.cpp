@@ -2,6 +2,242 @@
 
 #include "sentence.hpp"
 
+#include "object.hpp"
+#include "parse.hpp"
+
 #include "catch.hpp"
 
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
+static Sentence* parse(const char* line) {
+	TokVec tokens = tokenizeView(line);
+	Index i = 0;
+	return parseSentence(tokens, i).release();
+}
+
+TEST_CASE("sentences compare and hash structurally", "[sentence]") {
+	Sentence* s = parse("(forall x in ZZ (iff (< x 1) (in x {1, 2})))");
+	REQUIRE(s != nullptr);
+	Sentence* t = s->clone();
+	CHECK(s->equal(*t));
+	CHECK(s->hash() == t->hash());
+
+	// Negating changes the hash, and negating back restores it.
+	std::uint64_t h = t->hash();
+	t->negate();
+	CHECK(!s->equal(*t));
+	CHECK(t->hash() != h);
+	Sentence* u = parse("(< 1 2)");
+	Sentence* v = parse("(< 1 2)");
+	u->negate();
+	CHECK(!u->equal(*v));
+	u->negate();
+	CHECK(u->equal(*v));
+
+	std::unordered_set<const Sentence*, SentenceHash, SentenceEqual> set;
+	CHECK(set.insert(s).second);
+	CHECK(set.insert(t).second);
+	CHECK(set.insert(u).second);
+	CHECK(!set.insert(v).second);
+	delete s;
+	delete t;
+	delete u;
+	delete v;
+}
+
+TEST_CASE("decompositions and deductions are built on demand", "[sentence]") {
+	SentencePtr s(parse("(=> (in 0 ZZ) (< 1 2))"));
+	SentencePtr notA(parse("(in 0 ZZ)"));
+	SentencePtr notB(parse("(< 1 2)"));
+	notA->negate();
+	notB->negate();
+
+	std::size_t before = nodeCount();
+	std::vector<Decomp> decomps = s->decompose();
+	std::vector<Deduct> deducts = s->deduce();
+	CHECK(nodeCount() == before);
+	REQUIRE(decomps.size() == 2);
+	CHECK(decomps[0]._source == s.get());
+	SentencePtr givenA, goalA, givenB, goalB;
+	decomps[1].build(givenA, goalA, givenB, goalB);
+	REQUIRE(givenA != nullptr);
+	CHECK(givenA->equal(*notB));
+	CHECK(goalA->equal(*notA));
+	CHECK(givenB == nullptr);
+	CHECK(goalB == nullptr);
+
+	REQUIRE(deducts.size() == 2);
+	SentencePtr hyp = deducts[1].hypothesis();
+	SentencePtr conc = deducts[1].conclusion();
+	CHECK(hyp->equal(*notB));
+	CHECK(conc->equal(*notA));
+
+	SentencePtr t(parse("(and (in 0 ZZ) (< 1 2))"));
+	CHECK(t->deduce()[0].hypothesis() == nullptr);
+}
+
+TEST_CASE("negation is lazy and keeps biconditionals", "[sentence]") {
+	Sentence* s = parse("(iff (< 1 2) (< 2 1))");
+	s->negate();
+	std::ostringstream out;
+	out << *s;
+	CHECK(out.str() == "(iff (< 1 2) (>= 2 1))");
+	CHECK(s->value() == Sentence::TRUE);
+	delete s;
+
+	// Splitting each negated iff into two implications would copy the
+	// operands at every level, which takes exponential time.
+	std::string text = "(< 1 2)";
+	for (int i = 0; i < 40; ++i) {
+		text = "(iff " + text + " (= 0 0))";
+	}
+	s = parse(text.c_str());
+	Sentence* t = s->clone();
+	s->negate();
+	CHECK(s->value() == Sentence::FALSE);
+	CHECK(!s->equal(*t));
+	s->negate();
+	CHECK(s->equal(*t));
+	delete s;
+	delete t;
+}
+
+
+// Parses the line and returns the value of the sentence.
+static Sentence::Value valueOf(const char* line) {
+	Sentence* s = parse(line);
+	REQUIRE(s != nullptr);
+	Sentence::Value v = s->value();
+	s->negate();
+	Sentence::Value n = s->value();
+	delete s;
+	// Negation must agree with evaluation.
+	CHECK(n == valueNot(v));
+	return v;
+}
+
+TEST_CASE("ground relations evaluate", "[sentence]") {
+	CHECK(valueOf("(= (+ 1 2) 3)") == Sentence::TRUE);
+	CHECK(valueOf("(< (* 4 5) 19)") == Sentence::FALSE);
+	CHECK(valueOf("(<= 2 2)") == Sentence::TRUE);
+	CHECK(valueOf("(div 3 12)") == Sentence::TRUE);
+	CHECK(valueOf("(div 0 5)") == Sentence::FALSE);
+	CHECK(valueOf("(div 3 99999999999999999999)") == Sentence::TRUE);
+	CHECK(valueOf("(div 7 99999999999999999999)") == Sentence::FALSE);
+	CHECK(valueOf("(div 99999999999999999999 199999999999999999998)")
+		== Sentence::TRUE);
+	CHECK(valueOf("(in 3 {1, 2, 3})") == Sentence::TRUE);
+	CHECK(valueOf("(in {2, 1} {{1, 2}})") == Sentence::TRUE);
+	CHECK(valueOf("(in {1, ..., 2} {{1, 2}})") == Sentence::TRUE);
+	CHECK(valueOf("(in 4000000 {1, ..., 1000000})") == Sentence::FALSE);
+	CHECK(valueOf("(in 99999999999999999999 {0, ...})") == Sentence::TRUE);
+	CHECK(valueOf("(in 5 (diff ZZ {5}))") == Sentence::FALSE);
+	CHECK(valueOf("(in {} SS)") == Sentence::TRUE);
+	CHECK(valueOf("(sube {1, 2} {0, ..., 9})") == Sentence::TRUE);
+	CHECK(valueOf("(sub {1, 2} {2, 1})") == Sentence::FALSE);
+	CHECK(valueOf("(s= {1, 2, 3} {1, ..., 3})") == Sentence::TRUE);
+	CHECK(valueOf("(sube {0, ...} {1, 2})") == Sentence::FALSE);
+	CHECK(valueOf("(= {1} 1)") == Sentence::FALSE);
+
+	// Anything involving a free symbol stays unknown.
+	CHECK(valueOf("(= x 1)") == Sentence::MU);
+	CHECK(valueOf("(in x {1, 2})") == Sentence::MU);
+	CHECK(valueOf("(in 1 {x, 2})") == Sentence::MU);
+	CHECK(valueOf("(in 0 NN)") == Sentence::MU);
+	CHECK(valueOf("(and (= x 1) (= 1 2))") == Sentence::FALSE);
+	CHECK(valueOf("(or (= x 1) (= 1 1))") == Sentence::TRUE);
+}
+
+TEST_CASE("quantifiers over finite domains evaluate", "[sentence]") {
+	CHECK(valueOf("(forall x in {1, ..., 100} (< 0 x))") == Sentence::TRUE);
+	CHECK(valueOf("(forall x in {1, ..., 100} (< x 100))") == Sentence::FALSE);
+	CHECK(valueOf("(exists x in {1, ..., 100} (= (* x x) 49))")
+		== Sentence::TRUE);
+	CHECK(valueOf("(forall x in {1, 2, 3} (exists y in {2, 4, 6} "
+		"(= (* 2 x) y)))") == Sentence::TRUE);
+	CHECK(valueOf("(forall x in {} (= 1 2))") == Sentence::TRUE);
+	CHECK(valueOf("(forall x in {{1}, {2}} (sube x {1, 2}))")
+		== Sentence::TRUE);
+	CHECK(valueOf("(forall x in ZZ (= x x))") == Sentence::MU);
+	CHECK(valueOf("(forall x (= x x))") == Sentence::MU);
+
+	// Nested quantifiers give up when they use up the budget.
+	CHECK(valueOf("(forall x in {1, ..., 2000} (forall y in {1, ..., 2000} "
+		"(< 0 (+ x y))))") == Sentence::MU);
+}
+
+TEST_CASE("bound variables are compared and substituted by index",
+		"[sentence]") {
+	// Renaming bound variables gives an equal sentence.
+	SentencePtr s(parse("(forall x (exists y (< x y)))"));
+	SentencePtr t(parse("(forall a (exists b (< a b)))"));
+	SentencePtr u(parse("(forall x (exists y (< y x)))"));
+	CHECK(s->equal(*t));
+	CHECK(s->hash() == t->hash());
+	CHECK(!s->equal(*u));
+
+	// Instantiating with a free y does not capture it in the inner exists.
+	auto q = dynamic_cast<const Quantified*>(s.get());
+	REQUIRE(q != nullptr);
+	Symbol y("y");
+	SentencePtr body = q->instantiate(y);
+	std::ostringstream out;
+	out << *body;
+	CHECK(out.str() == "(exists y (< y y))");
+	SentencePtr same(parse("(exists z (< z z))"));
+	CHECK(!body->equal(*same));
+	auto inner = dynamic_cast<const Quantified*>(body.get());
+	REQUIRE(inner != nullptr);
+	ConcreteNumber five(5);
+	SentencePtr r = inner->instantiate(five);
+	Relation expected(Relation::LT, true, y.clone(), five.clone());
+	CHECK(r->equal(expected));
+
+	// Substituted sets are put back in canonical form.
+	s.reset(parse("(forall x in NN (s= {x, 3} {3}))"));
+	q = dynamic_cast<const Quantified*>(s.get());
+	REQUIRE(q != nullptr);
+	ConcreteNumber three(3);
+	r = q->instantiate(three);
+	out.str("");
+	out << *r;
+	CHECK(out.str() == "(=> (in 3 NN) (s= {3} {3}))");
+	CHECK(r->value() == Sentence::TRUE);
+}
+
+TEST_CASE("quantifiers are instantiated by deduction", "[sentence]") {
+	// A universal statement is instantiated with its own variable, and an
+	// existential one with a fresh witness each time.
+	SentencePtr all(parse("(forall x (< x 1))"));
+	SentencePtr some(parse("(exists x (< x 1))"));
+	SentencePtr a = all->deduce()[0].conclusion();
+	SentencePtr b = all->deduce()[0].conclusion();
+	SentencePtr c = some->deduce()[0].conclusion();
+	SentencePtr d = some->deduce()[0].conclusion();
+	CHECK(a->equal(*b));
+	CHECK(!c->equal(*d));
+	CHECK(!a->equal(*c));
+	std::ostringstream out;
+	out << *c;
+	CHECK(out.str() == "(< x 1)");
+}
+
+TEST_CASE("domain elements can refer to outer variables", "[sentence]") {
+	CHECK(valueOf("(forall x in {1} (forall y in {(+ x 1)} (= y 2)))")
+		== Sentence::TRUE);
+	CHECK(valueOf("(exists x in {1, 2} (forall y in {(* x 3)} (< 5 y)))")
+		== Sentence::TRUE);
+	// A domain that refers to its own variable has no value for it.
+	CHECK(valueOf("(forall y in {(+ y 1)} (= y 2))") == Sentence::MU);
+}
 
+TEST_CASE("values bound deeper in a body keep their meaning", "[sentence]") {
+	// Here y is 2, so (= y (+ y 1)) is false; comparing the captured (+ x 1)
+	// against the deeper (+ y 1) by index alone would make it true.
+	CHECK(valueOf("(forall x in {1} (forall y in {(+ x 1)} "
+		"(forall w in {0} (= y (+ y 1)))))") == Sentence::FALSE);
+	CHECK(valueOf("(forall x in {1} (forall y in {(+ x 1)} "
+		"(forall w in {0} (= y (+ x 1)))))") == Sentence::TRUE);
+}